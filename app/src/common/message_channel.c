@@ -10,90 +10,13 @@
 
 #include "message_channel.h"
 
-ZBUS_CHAN_DEFINE(TRIGGER_CHAN,
-		 enum trigger_type,
-		 NULL,
-		 NULL,
-		 ZBUS_OBSERVERS_EMPTY,
-		 ZBUS_MSG_INIT(0)
-);
-
-ZBUS_CHAN_DEFINE(TRIGGER_MODE_CHAN,
-		 enum trigger_mode,
-		 NULL,
-		 NULL,
-		 ZBUS_OBSERVERS_EMPTY,
-		 ZBUS_MSG_INIT(0)
-);
-
-ZBUS_CHAN_DEFINE(FOTA_STATUS_CHAN,
-		 enum fota_status,
-		 NULL,
-		 NULL,
-		 ZBUS_OBSERVERS_EMPTY,
-		 ZBUS_MSG_INIT(0)
-);
-
-ZBUS_CHAN_DEFINE(PAYLOAD_CHAN,
-		 struct payload,
-		 NULL,
-		 NULL,
-		 ZBUS_OBSERVERS_EMPTY,
-		 ZBUS_MSG_INIT(0)
-);
-
-ZBUS_CHAN_DEFINE(NETWORK_CHAN,
-		 enum network_status,
-		 NULL,
-		 NULL,
-		 ZBUS_OBSERVERS_EMPTY,
-		 NETWORK_DISCONNECTED
-);
-
-ZBUS_CHAN_DEFINE(ERROR_CHAN,
-		 enum error_type,
-		 NULL,
-		 NULL,
-		 ZBUS_OBSERVERS_EMPTY,
-		 ZBUS_MSG_INIT(0)
-);
-
-ZBUS_CHAN_DEFINE(CONFIG_CHAN,
-		 struct configuration,
-		 NULL,
-		 NULL,
-		 ZBUS_OBSERVERS_EMPTY,
-		 ZBUS_MSG_INIT(0)
-);
-
-ZBUS_CHAN_DEFINE(CLOUD_CHAN,
-		 enum cloud_status,
-		 NULL,
-		 NULL,
-		 ZBUS_OBSERVERS_EMPTY,
-		 CLOUD_DISCONNECTED
-);
-
-ZBUS_CHAN_DEFINE(BUTTON_CHAN,
-		 uint8_t,
-		 NULL,
-		 NULL,
-		 ZBUS_OBSERVERS_EMPTY,
-		 ZBUS_MSG_INIT(0)
-);
-
-ZBUS_CHAN_DEFINE(TIME_CHAN,
-		 enum time_status,
-		 NULL,
-		 NULL,
-		 ZBUS_OBSERVERS_EMPTY,
-		 ZBUS_MSG_INIT(0)
-);
-
-ZBUS_CHAN_DEFINE(LOCATION_CHAN,
-		 enum location_status,
-		 NULL,
-		 NULL,
-		 ZBUS_OBSERVERS_EMPTY,
-		 ZBUS_MSG_INIT(0)
-);
+#define _CHAN_DEFINE(_name, _type, _init)				\
+	ZBUS_CHAN_DEFINE(_name,						\
+			 _type,						\
+			 NULL,						\
+			 (void *)(uintptr_t)CHAN_ID_##_name,		\
+			 ZBUS_OBSERVERS_EMPTY,				\
+			 _init						\
+	);
+
+CHANNEL_REGISTRY(_CHAN_DEFINE)
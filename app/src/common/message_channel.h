@@ -117,40 +117,157 @@ enum fota_status {
 
 #define MSG_TO_FOTA_STATUS(_msg) (*(const enum fota_status *)_msg)
 
-struct configuration {
-	/* LED */
-	int led_red;
-	int led_green;
-	int led_blue;
-	bool led_present;
-	bool led_red_present;
-	bool led_green_present;
-	bool led_blue_present;
-
-	/* Configuration */
+/* Shadow objects are published on a channel per object, so that modules are only notified
+ * about the objects that they use. Only the resources present in the received object are
+ * flagged as present.
+ */
+
+/* LED object (14240), published on LED_CONFIG_CHAN */
+struct led_configuration {
+	int red;
+	int green;
+	int blue;
+	bool red_present;
+	bool green_present;
+	bool blue_present;
+};
+
+#define MSG_TO_LED_CONFIGURATION(_msg) ((const struct led_configuration *)_msg)
+
+/* Application configuration object (14301), published on APP_CONFIG_CHAN */
+struct app_configuration {
 	bool gnss;
 	uint64_t update_interval;
-	bool config_present;
 	bool gnss_present;
 	bool update_interval_present;
+
+	/* Trigger, transport and location policy, all values in seconds */
+	uint32_t frequent_poll_duration;
+	uint32_t frequent_poll_interval;
+	uint32_t reconnection_timeout;
+	uint32_t location_timeout;
+	bool frequent_poll_duration_present;
+	bool frequent_poll_interval_present;
+	bool reconnection_timeout_present;
+	bool location_timeout_present;
+};
+
+#define MSG_TO_APP_CONFIGURATION(_msg) ((const struct app_configuration *)_msg)
+
+/* Deadband of an environmental value. A value has changed if it differs from the last sent
+ * value by more than the deadbands that are set, a deadband of 0 is not set.
+ */
+struct env_deadband {
+	/* Hundredths of the unit of the value */
+	uint32_t absolute;
+	/* Tenths of a percent of the last sent value */
+	uint32_t relative;
+	bool absolute_present;
+	bool relative_present;
+};
+
+/* Environmental configuration object (14302), published on ENV_CONFIG_CHAN */
+struct env_configuration {
+	struct env_deadband temperature;
+	struct env_deadband humidity;
+	struct env_deadband pressure;
+	struct env_deadband iaq;
+
+	/* Number of sample intervals after which a sample is sent even if no value has changed */
+	uint32_t heartbeat;
+	bool heartbeat_present;
+
+	/* Resources of the environment object that are sent, ENV_RESOURCE_* */
+	uint32_t resources;
+	bool resources_present;
+
+	/* Bounds of the adaptive local sampling interval, in seconds */
+	uint32_t sample_interval_min;
+	uint32_t sample_interval_max;
+	bool sample_interval_min_present;
+	bool sample_interval_max_present;
+};
+
+/* Resources of the environment object (14205), the bit number is the resource ID */
+#define ENV_RESOURCE_TEMPERATURE	BIT(0)
+#define ENV_RESOURCE_HUMIDITY		BIT(1)
+#define ENV_RESOURCE_PRESSURE		BIT(2)
+#define ENV_RESOURCE_IAQ		BIT(10)
+#define ENV_RESOURCE_CO2		BIT(11)
+#define ENV_RESOURCE_VOC		BIT(12)
+#define ENV_RESOURCES_ALL		(ENV_RESOURCE_TEMPERATURE | ENV_RESOURCE_HUMIDITY |	\
+					 ENV_RESOURCE_PRESSURE | ENV_RESOURCE_IAQ |		\
+					 ENV_RESOURCE_CO2 | ENV_RESOURCE_VOC)
+
+/* Largest heartbeat, in sample intervals, accepted from the shadow and at build time */
+#define ENV_HEARTBEAT_INTERVALS_MAX 1000
+
+#define MSG_TO_ENV_CONFIGURATION(_msg) ((const struct env_configuration *)_msg)
+
+/** @brief Registry of the public channels.
+ *
+ *  Each entry is X(name, message type, initial value). The registry is the single place where
+ *  channels are listed. It is used to define and declare the channels, to define a message type
+ *  and an identifier for each channel, and by the helpers below to size message buffers and
+ *  register observers.
+ */
+#define CHANNEL_REGISTRY(X)								\
+	X(APP_CONFIG_CHAN,	struct app_configuration, ZBUS_MSG_INIT(0))		\
+	X(BUTTON_CHAN,		uint8_t,		ZBUS_MSG_INIT(0))		\
+	X(CLOUD_CHAN,		enum cloud_status,	CLOUD_DISCONNECTED)		\
+	X(ENV_CONFIG_CHAN,	struct env_configuration, ZBUS_MSG_INIT(0))		\
+	X(ERROR_CHAN,		enum error_type,	ZBUS_MSG_INIT(0))		\
+	X(FOTA_STATUS_CHAN,	enum fota_status,	ZBUS_MSG_INIT(0))		\
+	X(LED_CONFIG_CHAN,	struct led_configuration, ZBUS_MSG_INIT(0))		\
+	X(LOCATION_CHAN,	enum location_status,	ZBUS_MSG_INIT(0))		\
+	X(NETWORK_CHAN,		enum network_status,	NETWORK_DISCONNECTED)		\
+	X(PAYLOAD_CHAN,		struct payload,		ZBUS_MSG_INIT(0))		\
+	X(TIME_CHAN,		enum time_status,	ZBUS_MSG_INIT(0))		\
+	X(TRIGGER_CHAN,		enum trigger_type,	ZBUS_MSG_INIT(0))		\
+	X(TRIGGER_MODE_CHAN,	enum trigger_mode,	ZBUS_MSG_INIT(0))
+
+#define _CHAN_ID_ENTRY(_name, _type, _init)	CHAN_ID_##_name,
+#define _CHAN_MSG_TYPEDEF(_name, _type, _init)	typedef _type _name##_msg_t;
+#define _CHAN_DECLARE(_name, _type, _init)	ZBUS_CHAN_DECLARE(_name);
+
+/** @brief Channel identifiers. The identifier is stored as the user data of each channel.
+ *	   Channels that are not in the registry, such as module private channels, have the
+ *	   identifier CHAN_ID_UNKNOWN.
+ */
+enum chan_id {
+	CHAN_ID_UNKNOWN = 0,
+	CHANNEL_REGISTRY(_CHAN_ID_ENTRY)
+	CHAN_ID_COUNT,
 };
 
-#define MSG_TO_CONFIGURATION(_msg) ((const struct configuration *)_msg)
-
-ZBUS_CHAN_DECLARE(
-	BUTTON_CHAN,
-	CLOUD_CHAN,
-	CONFIG_CHAN,
-	ERROR_CHAN,
-	FOTA_STATUS_CHAN,
-	LED_CHAN,
-	NETWORK_CHAN,
-	PAYLOAD_CHAN,
-	TIME_CHAN,
-	TRIGGER_CHAN,
-	TRIGGER_MODE_CHAN,
-	LOCATION_CHAN
-);
+CHANNEL_REGISTRY(_CHAN_MSG_TYPEDEF)
+CHANNEL_REGISTRY(_CHAN_DECLARE)
+
+/** @brief Get the identifier of a channel, see enum chan_id.
+ *
+ *  @note Intended for switch statements that dispatch on the channel a message was received
+ *	  on, which the compiler can turn into a jump table.
+ */
+#define CHAN_ID(_chan)	((enum chan_id)(uintptr_t)zbus_chan_user_data(_chan))
+
+/** @brief Message type of a channel in the registry, for example TRIGGER_CHAN_msg_t. */
+#define CHAN_MSG_TYPE(_chan)	_chan##_msg_t
+
+#define _CHAN_MSG_MEMBER(_chan)		CHAN_MSG_TYPE(_chan) _chan;
+#define _CHAN_ADD_OBS(_chan, _obs)	ZBUS_CHAN_ADD_OBS(_chan, _obs, 0)
+
+/** @brief Size of the largest message of the given channels.
+ *
+ *  @param ... Channels in the registry.
+ */
+#define CHAN_MSG_SIZE_MAX(...)	sizeof(union { FOR_EACH(_CHAN_MSG_MEMBER, (), __VA_ARGS__) })
+
+/** @brief Add an observer to the given channels.
+ *
+ *  @param _obs Observer.
+ *  @param ... Channels to observe.
+ */
+#define CHAN_ADD_OBS(_obs, ...)	FOR_EACH_FIXED_ARG(_CHAN_ADD_OBS, (;), _obs, __VA_ARGS__)
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/barrier.h>
+#include <zephyr/zbus/zbus.h>
+#include <zephyr/shell/shell.h>
+
+#include "message_channel.h"
+#include "module_trace.h"
+
+#define RECORDS_MAX CONFIG_APP_MODULE_TRACE_BUFFER_RECORDS
+
+BUILD_ASSERT(IS_POWER_OF_TWO(RECORDS_MAX), "Trace buffer size must be a power of two");
+
+/* A record and its commit word. The commit word is 0 while the record is being written, and
+ * the record number plus one once it is complete.
+ */
+struct slot {
+	atomic_t commit;
+	struct module_trace_record record;
+};
+
+static struct slot slots[RECORDS_MAX];
+
+/* Total number of records written. The next record is written at head % RECORDS_MAX. */
+static atomic_t head;
+
+void module_trace_record(enum module_trace_event event, const void *ref, uint16_t arg)
+{
+	atomic_val_t index = atomic_inc(&head);
+	struct slot *slot = &slots[index & (RECORDS_MAX - 1)];
+
+	atomic_set(&slot->commit, 0);
+	barrier_dmem_fence_full();
+
+	slot->record.timestamp = (uint32_t)k_uptime_ticks();
+	slot->record.thread = k_current_get();
+	slot->record.ref = ref;
+	slot->record.arg = arg;
+	slot->record.event = event;
+
+	barrier_dmem_fence_full();
+	atomic_set(&slot->commit, index + 1);
+}
+
+int module_trace_get(size_t index, struct module_trace_record *record)
+{
+	atomic_val_t written = atomic_get(&head);
+	atomic_val_t count = MIN(written, RECORDS_MAX);
+	atomic_val_t number = written - count + index;
+	struct slot *slot = &slots[number & (RECORDS_MAX - 1)];
+
+	if (index >= count) {
+		return -ENOENT;
+	}
+
+	/* The record is only valid if it was complete before and after being copied, a writer
+	 * that wrapped the buffer in between changes the commit word.
+	 */
+	if (atomic_get(&slot->commit) != (number + 1)) {
+		return -EAGAIN;
+	}
+
+	barrier_dmem_fence_full();
+	*record = slot->record;
+	barrier_dmem_fence_full();
+
+	if (atomic_get(&slot->commit) != (number + 1)) {
+		return -EAGAIN;
+	}
+
+	return 0;
+}
+
+void module_trace_clear(void)
+{
+	atomic_set(&head, 0);
+
+	for (size_t i = 0; i < RECORDS_MAX; i++) {
+		atomic_set(&slots[i].commit, 0);
+	}
+}
+
+static const char *event_name_get(enum module_trace_event event)
+{
+	switch (event) {
+	case MODULE_TRACE_STATE_EXIT:
+		return "state_exit";
+	case MODULE_TRACE_STATE_ENTRY:
+		return "state_entry";
+	case MODULE_TRACE_CHAN_PUB:
+		return "chan_pub";
+	case MODULE_TRACE_CHAN_RECV:
+		return "chan_recv";
+	case MODULE_TRACE_WORK_BEGIN:
+		return "work_begin";
+	case MODULE_TRACE_WORK_END:
+		return "work_end";
+	default:
+		return "unknown";
+	}
+}
+
+static const char *ref_name_get(const struct module_trace_record *record)
+{
+	switch (record->event) {
+	case MODULE_TRACE_CHAN_PUB:
+	case MODULE_TRACE_CHAN_RECV:
+		return record->ref ? zbus_chan_name(record->ref) : "-";
+	case MODULE_TRACE_WORK_BEGIN:
+	case MODULE_TRACE_WORK_END:
+		return record->ref;
+	default:
+		return "-";
+	}
+}
+
+int module_trace_format(const struct module_trace_record *record, char *buf, size_t len)
+{
+	const char *thread_name = k_thread_name_get(record->thread);
+
+	/* trace,<timestamp us>,<event>,<thread>,<reference>,<argument> */
+	return snprintk(buf, len, "trace,%llu,%s,%s,%s,%u",
+			k_ticks_to_us_floor64(record->timestamp),
+			event_name_get(record->event),
+			(thread_name && thread_name[0]) ? thread_name : "unknown",
+			ref_name_get(record),
+			record->arg);
+}
+
+/* Record publishing on all public channels. Listeners run in the context of the publisher. */
+static void module_trace_callback(const struct zbus_channel *chan)
+{
+	module_trace_record(MODULE_TRACE_CHAN_PUB, chan, 0);
+}
+
+ZBUS_LISTENER_DEFINE(module_trace, module_trace_callback);
+
+#define _CHAN_TRACE(_name, _type, _init) ZBUS_CHAN_ADD_OBS(_name, module_trace, 0);
+
+CHANNEL_REGISTRY(_CHAN_TRACE)
+
+#if defined(CONFIG_SHELL)
+
+static int cmd_trace_dump(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	struct module_trace_record record;
+	char line[96];
+	size_t skipped = 0;
+	int err;
+
+	/* Records that are overwritten or being written while they are dumped are skipped */
+	for (size_t i = 0; (err = module_trace_get(i, &record)) != -ENOENT; i++) {
+		if (err) {
+			skipped++;
+			continue;
+		}
+
+		module_trace_format(&record, line, sizeof(line));
+		shell_print(sh, "%s", line);
+	}
+
+	if (skipped) {
+		shell_warn(sh, "%zu records overwritten during the dump", skipped);
+	}
+
+	return 0;
+}
+
+static int cmd_trace_clear(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	module_trace_clear();
+	shell_print(sh, "Trace buffer cleared");
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_trace,
+			       SHELL_CMD(dump, NULL, "Dump the module trace buffer", cmd_trace_dump),
+			       SHELL_CMD(clear, NULL, "Clear the module trace buffer", cmd_trace_clear),
+			       SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(trace, &sub_trace, "Module trace commands", NULL);
+
+#endif /* CONFIG_SHELL */
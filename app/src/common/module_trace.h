@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _MODULE_TRACE_H_
+#define _MODULE_TRACE_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/zbus/zbus.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Events recorded in the module trace buffer. */
+enum module_trace_event {
+	/* A state machine left the state given by the record argument */
+	MODULE_TRACE_STATE_EXIT = 0x1,
+	/* A state machine entered the state given by the record argument */
+	MODULE_TRACE_STATE_ENTRY,
+	/* A message was published on the channel referenced by the record */
+	MODULE_TRACE_CHAN_PUB,
+	/* A module started processing a message received on the channel referenced by the record */
+	MODULE_TRACE_CHAN_RECV,
+	/* A work item, named by the record reference, started executing */
+	MODULE_TRACE_WORK_BEGIN,
+	/* A work item, named by the record reference, finished executing */
+	MODULE_TRACE_WORK_END,
+};
+
+/** @brief A single trace record. */
+struct module_trace_record {
+	/* Uptime in ticks, truncated to 32 bits */
+	uint32_t timestamp;
+
+	/* Thread that the event happened in */
+	k_tid_t thread;
+
+	/* Channel for channel events, function name for work events, NULL otherwise */
+	const void *ref;
+
+	/* State index for state events, 0 otherwise */
+	uint16_t arg;
+
+	/* enum module_trace_event */
+	uint8_t event;
+};
+
+#if defined(CONFIG_APP_MODULE_TRACE)
+
+/* Listener that records publishing on a channel. Public channels are observed by default,
+ * module private channels can be added with ZBUS_CHAN_ADD_OBS().
+ */
+ZBUS_OBS_DECLARE(module_trace);
+
+/** @brief Record an event in the trace buffer. Safe to call from any context.
+ *
+ *  @param event Event type.
+ *  @param ref Reference associated with the event, see struct module_trace_record.
+ *  @param arg Argument associated with the event, see struct module_trace_record.
+ */
+void module_trace_record(enum module_trace_event event, const void *ref, uint16_t arg);
+
+/** @brief Get a record from the trace buffer.
+ *
+ *  @param index Index of the record, where 0 is the oldest record still in the buffer.
+ *  @param record Pointer to where the record is copied.
+ *
+ *  @return 0 on success, -ENOENT if there is no record with the given index, -EAGAIN if the
+ *	    record was overwritten or is being written.
+ */
+int module_trace_get(size_t index, struct module_trace_record *record);
+
+/** @brief Format a record as a single text line that can be parsed by
+ *	   scripts/module_trace_to_perfetto.py.
+ *
+ *  @param record Record to format.
+ *  @param buf Buffer where the line is written.
+ *  @param len Size of the buffer.
+ *
+ *  @return see snprintk().
+ */
+int module_trace_format(const struct module_trace_record *record, char *buf, size_t len);
+
+/** @brief Clear the trace buffer. */
+void module_trace_clear(void);
+
+#define MODULE_TRACE(_event, _ref, _arg) module_trace_record(_event, _ref, _arg)
+
+#else
+
+#define MODULE_TRACE(_event, _ref, _arg) ((void)0)
+
+#endif /* CONFIG_APP_MODULE_TRACE */
+
+/** @brief Record a state transition of a module state machine.
+ *
+ *  @note The macro requires that a state machine object named s_obj is defined and that a
+ *	  state array named states is defined.
+ *
+ *  @param _state State that is being transitioned to.
+ */
+#define MODULE_TRACE_STATE_SET(_state) (						\
+	(SMF_CTX(&s_obj)->current ?							\
+		MODULE_TRACE(MODULE_TRACE_STATE_EXIT, NULL,				\
+			     (uint16_t)(SMF_CTX(&s_obj)->current - states)) :		\
+		(void)0),								\
+	MODULE_TRACE(MODULE_TRACE_STATE_ENTRY, NULL, (uint16_t)(_state)))
+
+/** @brief Record the start of a work item handler. Must be called from the handler itself. */
+#define MODULE_TRACE_WORK_BEGIN() MODULE_TRACE(MODULE_TRACE_WORK_BEGIN, __func__, 0)
+
+/** @brief Record the end of a work item handler. Must be called from the handler itself. */
+#define MODULE_TRACE_WORK_END() MODULE_TRACE(MODULE_TRACE_WORK_END, __func__, 0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MODULE_TRACE_H_ */
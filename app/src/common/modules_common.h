@@ -7,6 +7,8 @@
 #ifndef _MODULES_COMMON_H_
 #define _MODULES_COMMON_H_
 
+#include "module_trace.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -20,7 +22,8 @@ extern "C" {
  *
  *  @return see smf_set_initial().
  */
-#define STATE_SET_INITIAL(_state)	smf_set_initial(SMF_CTX(&s_obj), &states[_state])
+#define STATE_SET_INITIAL(_state)	(MODULE_TRACE_STATE_SET(_state),			\
+					 smf_set_initial(SMF_CTX(&s_obj), &states[_state]))
 
 /** @brief Set the state for a module.
  *
@@ -31,7 +34,8 @@ extern "C" {
  *
  *  @return see smf_set_state().
  */
-#define STATE_SET(_state)		smf_set_state(SMF_CTX(&s_obj), &states[_state])
+#define STATE_SET(_state)		(MODULE_TRACE_STATE_SET(_state),			\
+					 smf_set_state(SMF_CTX(&s_obj), &states[_state]))
 
 /** @brief Set the state for a module and handle the event.
  *
@@ -46,11 +50,13 @@ extern "C" {
 
 /** @brief Run the state machine for a module.
  *
- *  @note The macro requires that a state machine object named s_obj is defined.
+ *  @note The macro requires that a state machine object named s_obj is defined, and that it
+ *	  holds the channel of the last received message in a member named chan.
  *
  *  @return see smf_run_state().
  */
-#define STATE_RUN()			smf_run_state(SMF_CTX(&s_obj))
+#define STATE_RUN()			(MODULE_TRACE(MODULE_TRACE_CHAN_RECV, s_obj.chan, 0),	\
+					 smf_run_state(SMF_CTX(&s_obj)))
 
 #ifdef __cplusplus
 }
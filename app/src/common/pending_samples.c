@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <date_time.h>
+
+#include "pending_samples.h"
+
+/* Register log module */
+LOG_MODULE_REGISTER(pending_samples, CONFIG_APP_PENDING_SAMPLES_LOG_LEVEL);
+
+void pending_samples_push(struct pending_samples *pending, const void *sample)
+{
+	size_t index;
+
+	if (pending->count == pending->capacity) {
+		LOG_WRN("%s: too many samples before time is available, dropping the oldest",
+			pending->name);
+
+		pending->head = (pending->head + 1) % pending->capacity;
+		pending->count--;
+	}
+
+	index = (pending->head + pending->count) % pending->capacity;
+
+	memcpy(&pending->samples[index * pending->sample_size], sample, pending->sample_size);
+	pending->uptimes_ms[index] = k_uptime_get();
+	pending->count++;
+
+	LOG_DBG("%s: time not available, sample kept, %zu of %zu", pending->name,
+		pending->count, pending->capacity);
+}
+
+void pending_samples_flush(struct pending_samples *pending, pending_samples_cb_t cb)
+{
+	int err;
+	size_t index;
+	int64_t system_time;
+
+	for (size_t i = 0; i < pending->count; i++) {
+		index = (pending->head + i) % pending->capacity;
+		system_time = pending->uptimes_ms[index];
+
+		err = date_time_uptime_to_unix_time_ms(&system_time);
+		if (err) {
+			LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
+			continue;
+		}
+
+		cb(&pending->samples[index * pending->sample_size], system_time);
+	}
+
+	pending->head = 0;
+	pending->count = 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _PENDING_SAMPLES_H_
+#define _PENDING_SAMPLES_H_
+
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Samples of a module taken before time is available, kept with their uptime.
+ *
+ *  @note Use PENDING_SAMPLES_DEFINE() to define an instance, the fields are private.
+ */
+struct pending_samples {
+	/* Name of the instance, used in log messages */
+	const char *name;
+
+	/* Storage of the samples and of their uptimes, capacity entries each */
+	uint8_t *samples;
+	int64_t *uptimes_ms;
+	size_t sample_size;
+	size_t capacity;
+
+	/* Position of the oldest sample, and the number of samples kept */
+	size_t head;
+	size_t count;
+};
+
+/** @brief Define an instance that keeps up to CONFIG_APP_PENDING_SAMPLES samples.
+ *
+ *  @param _name Name of the instance.
+ *  @param _type Type of the samples.
+ */
+#define PENDING_SAMPLES_DEFINE(_name, _type)						\
+	static _type _CONCAT(_name, _samples)[CONFIG_APP_PENDING_SAMPLES];		\
+	static int64_t _CONCAT(_name, _uptimes_ms)[CONFIG_APP_PENDING_SAMPLES];		\
+	static struct pending_samples _name = {						\
+		.name = STRINGIFY(_name),						\
+		.samples = (uint8_t *)_CONCAT(_name, _samples),				\
+		.uptimes_ms = _CONCAT(_name, _uptimes_ms),				\
+		.sample_size = sizeof(_type),						\
+		.capacity = CONFIG_APP_PENDING_SAMPLES,					\
+	}
+
+/** @brief Called for each pending sample when the samples are flushed.
+ *
+ *  @param sample The sample.
+ *  @param system_time_ms UNIX time in milliseconds when the sample was taken.
+ */
+typedef void (*pending_samples_cb_t)(const void *sample, int64_t system_time_ms);
+
+/** @brief Keep a sample with the current uptime. The oldest sample is dropped if the
+ *	   instance is full.
+ *
+ *  @param pending Instance.
+ *  @param sample Sample, copied into the instance.
+ */
+void pending_samples_push(struct pending_samples *pending, const void *sample);
+
+/** @brief Timestamp the pending samples from their uptime and pass them to @p cb, oldest
+ *	   first. Must be called once time is available. Samples whose uptime cannot be
+ *	   converted are dropped. The instance is empty afterwards.
+ *
+ *  @param pending Instance.
+ *  @param cb Callback called for each sample.
+ */
+void pending_samples_flush(struct pending_samples *pending, pending_samples_cb_t cb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PENDING_SAMPLES_H_ */
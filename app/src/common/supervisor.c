@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/zbus/zbus.h>
+#include <zephyr/task_wdt/task_wdt.h>
+
+#include "message_channel.h"
+#include "supervisor.h"
+
+/* Register log module */
+LOG_MODULE_REGISTER(supervisor, CONFIG_APP_SUPERVISOR_LOG_LEVEL);
+
+BUILD_ASSERT(CONFIG_APP_THREAD_PRIORITY_CRITICAL < CONFIG_APP_THREAD_PRIORITY_NORMAL &&
+	     CONFIG_APP_THREAD_PRIORITY_NORMAL < CONFIG_APP_THREAD_PRIORITY_BULK &&
+	     CONFIG_APP_THREAD_PRIORITY_BULK < K_LOWEST_APPLICATION_THREAD_PRIO,
+	     "Thread priority classes must be ordered and above the supervisor priority");
+
+BUILD_ASSERT(CONFIG_APP_SUPERVISOR_WATCHDOG_TIMEOUT_SECONDS >
+	     CONFIG_APP_SUPERVISOR_CHECK_INTERVAL_SECONDS,
+	     "Watchdog timeout must be greater than the check interval");
+
+struct supervisor_entry {
+	/* Message subscriber that the module thread blocks on, NULL for a work queue */
+	const struct zbus_observer *obs;
+
+	/* Module thread, used for logging */
+	k_tid_t thread;
+
+	/* Maximum time the module may go without making progress */
+	uint32_t timeout_ms;
+
+	/* Number of events that the module has started processing */
+	uint32_t checkins;
+
+	/* Set while the module is processing an event, and the uptime when it started */
+	bool busy;
+	uint32_t busy_since;
+
+	/* Set while messages are pending without the module processing any. The number of
+	 * check-ins and the uptime when this was first detected are stored to measure progress.
+	 */
+	bool stalled;
+	uint32_t stalled_checkins;
+	uint32_t stalled_since;
+};
+
+static struct supervisor_entry entries[CONFIG_APP_SUPERVISOR_ENTRIES_MAX];
+static size_t entry_count;
+static struct k_spinlock lock;
+
+static int entry_add(const struct zbus_observer *obs, k_tid_t thread, uint32_t timeout_ms)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	int id;
+
+	if (entry_count == ARRAY_SIZE(entries)) {
+		k_spin_unlock(&lock, key);
+		return -ENOMEM;
+	}
+
+	id = entry_count++;
+
+	entries[id] = (struct supervisor_entry) {
+		.obs = obs,
+		.thread = thread,
+		.timeout_ms = timeout_ms,
+	};
+
+	k_spin_unlock(&lock, key);
+
+	return id;
+}
+
+int supervisor_add(const struct zbus_observer *obs, uint32_t timeout_ms)
+{
+	if (obs->type != ZBUS_OBSERVER_MSG_SUBSCRIBER_TYPE) {
+		return -EINVAL;
+	}
+
+	return entry_add(obs, k_current_get(), timeout_ms);
+}
+
+int supervisor_add_work_queue(struct k_work_q *queue, uint32_t timeout_ms)
+{
+	return entry_add(NULL, k_work_queue_thread_get(queue), timeout_ms);
+}
+
+void supervisor_checkin(int id)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	entries[id].checkins++;
+	entries[id].busy = true;
+	entries[id].busy_since = k_uptime_get_32();
+
+	k_spin_unlock(&lock, key);
+}
+
+void supervisor_checkout(int id)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	entries[id].busy = false;
+
+	k_spin_unlock(&lock, key);
+}
+
+/* Must be called with the lock held */
+static bool entry_is_responsive(struct supervisor_entry *entry, uint32_t now)
+{
+	if (entry->busy) {
+		entry->stalled = false;
+
+		return (now - entry->busy_since) <= entry->timeout_ms;
+	}
+
+	/* Work queues are only supervised while a work item runs */
+	if (!entry->obs || k_fifo_is_empty(entry->obs->message_fifo)) {
+		entry->stalled = false;
+
+		return true;
+	}
+
+	/* Messages are pending but the module is not processing any. This is expected for a
+	 * short while after publishing, so only start measuring from the first time it is seen
+	 * and restart whenever the module has made progress since.
+	 */
+	if (!entry->stalled || (entry->stalled_checkins != entry->checkins)) {
+		entry->stalled = true;
+		entry->stalled_checkins = entry->checkins;
+		entry->stalled_since = now;
+
+		return true;
+	}
+
+	return (now - entry->stalled_since) <= entry->timeout_ms;
+}
+
+static k_tid_t unresponsive_thread_get(void)
+{
+	k_tid_t thread = NULL;
+	uint32_t now = k_uptime_get_32();
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	for (size_t i = 0; i < entry_count; i++) {
+		if (!entry_is_responsive(&entries[i], now)) {
+			thread = entries[i].thread;
+			break;
+		}
+	}
+
+	k_spin_unlock(&lock, key);
+
+	return thread;
+}
+
+static void task_wdt_callback(int channel_id, void *user_data)
+{
+	LOG_ERR("Watchdog expired, Channel: %d, Thread: %s",
+		channel_id, k_thread_name_get((k_tid_t)user_data));
+
+	SEND_FATAL_ERROR_WATCHDOG_TIMEOUT();
+}
+
+static void supervisor_task(void)
+{
+	int err;
+	int task_wdt_id;
+	k_tid_t thread;
+	const uint32_t wdt_timeout_ms = (CONFIG_APP_SUPERVISOR_WATCHDOG_TIMEOUT_SECONDS * MSEC_PER_SEC);
+
+	LOG_DBG("Supervisor task started");
+
+	task_wdt_id = task_wdt_add(wdt_timeout_ms, task_wdt_callback, (void *)k_current_get());
+	if (task_wdt_id < 0) {
+		LOG_ERR("Failed to add task to watchdog: %d", task_wdt_id);
+		SEND_FATAL_ERROR();
+		return;
+	}
+
+	while (true) {
+		err = task_wdt_feed(task_wdt_id);
+		if (err) {
+			LOG_ERR("task_wdt_feed, error: %d", err);
+			SEND_FATAL_ERROR();
+			return;
+		}
+
+		k_sleep(K_SECONDS(CONFIG_APP_SUPERVISOR_CHECK_INTERVAL_SECONDS));
+
+		thread = unresponsive_thread_get();
+		if (thread) {
+			LOG_ERR("Module thread unresponsive: %s", k_thread_name_get(thread));
+			SEND_FATAL_ERROR_WATCHDOG_TIMEOUT();
+			return;
+		}
+	}
+}
+
+/* The supervisor runs at the lowest application priority so that it is starved, and the
+ * task watchdog expires, if any other application thread keeps the CPU busy.
+ */
+K_THREAD_DEFINE(supervisor_task_id,
+		CONFIG_APP_SUPERVISOR_THREAD_STACK_SIZE,
+		supervisor_task, NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+
+static int watchdog_init(void)
+{
+	__ASSERT((task_wdt_init(NULL) == 0), "Task watchdog init failure");
+
+	return 0;
+}
+
+SYS_INIT(watchdog_init, POST_KERNEL, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _SUPERVISOR_H_
+#define _SUPERVISOR_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/zbus/zbus.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Register the calling module thread with the supervisor.
+ *
+ *  @note Module threads block on their zbus message subscriber without a timeout and only
+ *	  check in when they process an event. The supervisor runs at a low rate and declares
+ *	  a module unresponsive if it has been busy processing a single event for longer than
+ *	  @p timeout_ms, or if messages have been pending in its queue for longer than
+ *	  @p timeout_ms without the module making progress.
+ *
+ *  @param obs Message subscriber observer used by the module thread.
+ *  @param timeout_ms Maximum time in milliseconds the module may go without progress.
+ *
+ *  @return Supervisor ID to be used with supervisor_checkin() and supervisor_checkout(),
+ *	    or a negative error code on failure.
+ */
+int supervisor_add(const struct zbus_observer *obs, uint32_t timeout_ms);
+
+/** @brief Register a work queue of a module with the supervisor.
+ *
+ *  @note The work items check in and out themselves. The work queue is declared unresponsive
+ *	  if a work item has been running for longer than @p timeout_ms.
+ *
+ *  @param queue Work queue, it must have been started.
+ *  @param timeout_ms Maximum time in milliseconds a work item may run.
+ *
+ *  @return Supervisor ID to be used with supervisor_checkin() and supervisor_checkout(),
+ *	    or a negative error code on failure.
+ */
+int supervisor_add_work_queue(struct k_work_q *queue, uint32_t timeout_ms);
+
+/** @brief Check in with the supervisor when a module starts processing an event.
+ *
+ *  @param id Supervisor ID returned by supervisor_add().
+ */
+void supervisor_checkin(int id);
+
+/** @brief Check out with the supervisor when a module has finished processing an event.
+ *
+ *  @param id Supervisor ID returned by supervisor_add().
+ */
+void supervisor_checkout(int id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SUPERVISOR_H_ */
@@ -7,7 +7,7 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/zbus/zbus.h>
-#include <zephyr/task_wdt/task_wdt.h>
+#include <zephyr/sys/crc.h>
 #include <date_time.h>
 #include <net/nrf_cloud_coap.h>
 #include <nrf_cloud_coap_transport.h>
@@ -16,8 +16,15 @@
 #include <memfault/core/trace_event.h>
 #endif /* CONFIG_MEMFAULT */
 
+#if defined(CONFIG_APP_CONFIG_PERSIST)
+#include <zephyr/settings/settings.h>
+#include "config_stored.h"
+#endif /* CONFIG_APP_CONFIG_PERSIST */
+
 #include "message_channel.h"
-#include "app_object_decode.h"
+#include "module_trace.h"
+#include "supervisor.h"
+#include "shadow_decode.h"
 
 /* Register log module */
 LOG_MODULE_REGISTER(app, CONFIG_APP_LOG_LEVEL);
@@ -26,48 +33,495 @@ LOG_MODULE_REGISTER(app, CONFIG_APP_LOG_LEVEL);
 ZBUS_MSG_SUBSCRIBER_DEFINE(app);
 
 /* Observe channels */
-ZBUS_CHAN_ADD_OBS(TRIGGER_CHAN, app, 0);
-ZBUS_CHAN_ADD_OBS(CLOUD_CHAN, app, 0);
+#define CHANNELS TRIGGER_CHAN, CLOUD_CHAN, BUTTON_CHAN
+
+CHAN_ADD_OBS(app, CHANNELS);
+
+#define MAX_MSG_SIZE CHAN_MSG_SIZE_MAX(CHANNELS)
+
+/* Shadow operations requested from the shadow workqueue. Requests are flags, so that
+ * requests of the same kind that are issued while one is pending are handled once.
+ */
+enum shadow_request {
+	/* Reset the shadow delta poll interval to the minimum */
+	SHADOW_REQ_BACKOFF_RESET = BIT(0),
+	/* Request the full shadow */
+	SHADOW_REQ_FULL = BIT(1),
+	/* Request the shadow delta, if the poll interval has passed */
+	SHADOW_REQ_POLL = BIT(2),
+	/* Send the pending reported state */
+	SHADOW_REQ_REPORT = BIT(3),
+};
+
+/* Requests that need a cloud connection, dropped when the connection is lost */
+#define SHADOW_REQ_CLOUD (SHADOW_REQ_FULL | SHADOW_REQ_POLL)
+
+static atomic_t shadow_requests;
+
+static void shadow_work_fn(struct k_work *work);
+static K_WORK_DEFINE(shadow_work, shadow_work_fn);
+
+/* Define stack_area of the shadow workqueue */
+static K_THREAD_STACK_DEFINE(shadow_stack_area, CONFIG_APP_SHADOW_WORKQUEUE_STACK_SIZE);
+
+/* Workqueue used for shadow requests, so that the app thread keeps processing messages
+ * while a request is waiting for the network.
+ */
+static struct k_work_q shadow_queue;
+static int shadow_supervisor_id;
+
+BUILD_ASSERT(CONFIG_APP_SHADOW_POLL_INTERVAL_MAX_SECONDS >=
+	     CONFIG_APP_SHADOW_POLL_INTERVAL_MIN_SECONDS,
+	     "Maximum shadow poll interval must not be less than the minimum interval");
+
+/* Poll triggers are scheduled with some jitter, allow them to arrive this much early */
+#define SHADOW_POLL_SLACK_MS 2000
+
+/* Current shadow delta poll interval and uptime of the last shadow request */
+static uint32_t shadow_poll_interval_sec = CONFIG_APP_SHADOW_POLL_INTERVAL_MIN_SECONDS;
+static int64_t shadow_poll_last_ms;
+static bool shadow_polled;
+
+/* Timestamps (resource 99) of the last applied instance of each object, and the CRC of the
+ * last shadow document that was found to contain no changes or was applied.
+ */
+static int64_t led_applied_timestamp;
+static int64_t config_applied_timestamp;
+static int64_t env_config_applied_timestamp;
+static uint32_t shadow_applied_crc;
+
+/* Objects applied so far, merged from all received instances */
+static struct led_configuration led_applied;
+static struct app_configuration config_applied;
+static struct env_configuration env_config_applied;
+
+static void led_config_merge(struct led_configuration *dst, const struct led_configuration *src)
+{
+	if (src->red_present) {
+		dst->red = src->red;
+		dst->red_present = true;
+	}
+
+	if (src->green_present) {
+		dst->green = src->green;
+		dst->green_present = true;
+	}
+
+	if (src->blue_present) {
+		dst->blue = src->blue;
+		dst->blue_present = true;
+	}
+}
+
+static void app_config_merge(struct app_configuration *dst, const struct app_configuration *src)
+{
+	if (src->update_interval_present) {
+		dst->update_interval = src->update_interval;
+		dst->update_interval_present = true;
+	}
+
+	if (src->gnss_present) {
+		dst->gnss = src->gnss;
+		dst->gnss_present = true;
+	}
+
+	if (src->frequent_poll_duration_present) {
+		dst->frequent_poll_duration = src->frequent_poll_duration;
+		dst->frequent_poll_duration_present = true;
+	}
+
+	if (src->frequent_poll_interval_present) {
+		dst->frequent_poll_interval = src->frequent_poll_interval;
+		dst->frequent_poll_interval_present = true;
+	}
+
+	if (src->reconnection_timeout_present) {
+		dst->reconnection_timeout = src->reconnection_timeout;
+		dst->reconnection_timeout_present = true;
+	}
+
+	if (src->location_timeout_present) {
+		dst->location_timeout = src->location_timeout;
+		dst->location_timeout_present = true;
+	}
+}
+
+static void env_deadband_merge(struct env_deadband *dst, const struct env_deadband *src)
+{
+	if (src->absolute_present) {
+		dst->absolute = src->absolute;
+		dst->absolute_present = true;
+	}
+
+	if (src->relative_present) {
+		dst->relative = src->relative;
+		dst->relative_present = true;
+	}
+}
+
+static void env_config_merge(struct env_configuration *dst, const struct env_configuration *src)
+{
+	env_deadband_merge(&dst->temperature, &src->temperature);
+	env_deadband_merge(&dst->humidity, &src->humidity);
+	env_deadband_merge(&dst->pressure, &src->pressure);
+	env_deadband_merge(&dst->iaq, &src->iaq);
+
+	if (src->heartbeat_present) {
+		dst->heartbeat = src->heartbeat;
+		dst->heartbeat_present = true;
+	}
+
+	if (src->resources_present) {
+		dst->resources = src->resources;
+		dst->resources_present = true;
+	}
+
+	if (src->sample_interval_min_present) {
+		dst->sample_interval_min = src->sample_interval_min;
+		dst->sample_interval_min_present = true;
+	}
+
+	if (src->sample_interval_max_present) {
+		dst->sample_interval_max = src->sample_interval_max;
+		dst->sample_interval_max_present = true;
+	}
+}
+
+/* Upper bounds of the policy values in seconds. The location timeout is converted to a 32 bit
+ * number of milliseconds by the location library.
+ */
+#define POLICY_FREQUENT_POLL_DURATION_MAX_SEC	(7 * 24 * 60 * 60)
+#define POLICY_FREQUENT_POLL_INTERVAL_MAX_SEC	(24 * 60 * 60)
+#define POLICY_RECONNECTION_TIMEOUT_MAX_SEC	(24 * 60 * 60)
+#define POLICY_LOCATION_TIMEOUT_MAX_SEC		(60 * 60)
+#define POLICY_SAMPLE_INTERVAL_MAX_SEC		(24 * 60 * 60)
+
+BUILD_ASSERT(POLICY_LOCATION_TIMEOUT_MAX_SEC <= (INT32_MAX / MSEC_PER_SEC),
+	     "Maximum location timeout must fit in 32 bits when given in milliseconds");
+
+/* Policy values are durations in seconds or counts, values that are not positive or larger
+ * than the given maximum are ignored.
+ */
+static bool policy_value_get(bool present, int32_t value, int32_t max, uint32_t *dst)
+{
+	if (!present) {
+		return false;
+	}
+
+	if ((value <= 0) || (value > max)) {
+		LOG_WRN("Ignoring invalid policy value: %d, maximum: %d", value, max);
+		return false;
+	}
+
+	*dst = value;
+
+	return true;
+}
+
+/* Deadbands of 0 are not set, negative values are ignored */
+static bool deadband_value_get(bool present, int32_t value, uint32_t *dst)
+{
+	if (!present) {
+		return false;
+	}
+
+	if (value < 0) {
+		LOG_WRN("Ignoring invalid deadband value: %d", value);
+		return false;
+	}
+
+	*dst = value;
+
+	return true;
+}
+
+#if defined(CONFIG_APP_CONFIG_PERSIST)
+
+BUILD_ASSERT(CONFIG_APP_CONFIG_PERSIST_INIT_PRIORITY > CONFIG_APPLICATION_INIT_PRIORITY,
+	     "The stored configuration must be published after the modules are initialized");
+
+static int config_settings_set(const char *name, size_t len, settings_read_cb read_cb,
+			       void *cb_arg)
+{
+	int ret;
+	struct config_stored stored;
+
+	if (!settings_name_steq(name, CONFIG_STORED_SETTINGS_NAME, NULL)) {
+		return -ENOENT;
+	}
+
+	/* The layout may differ if the configuration structure has changed in an update,
+	 * in that case the configuration is obtained from the cloud instead.
+	 */
+	if (len != sizeof(stored)) {
+		LOG_WRN("Stored configuration has unexpected size: %zu, ignoring", len);
+		return 0;
+	}
+
+	ret = read_cb(cb_arg, &stored, sizeof(stored));
+	if (ret < 0) {
+		LOG_ERR("Failed to read stored configuration: %d", ret);
+		return ret;
+	}
+
+	if (stored.version != CONFIG_STORED_VERSION) {
+		LOG_WRN("Stored configuration has unexpected version: %u, ignoring",
+			stored.version);
+		return 0;
+	}
+
+	led_applied = stored.led;
+	config_applied = stored.config;
+	env_config_applied = stored.env_config;
+	led_applied_timestamp = stored.led_timestamp;
+	config_applied_timestamp = stored.config_timestamp;
+	env_config_applied_timestamp = stored.env_config_timestamp;
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(app, CONFIG_STORED_SETTINGS_KEY, NULL, config_settings_set, NULL,
+			       NULL);
+
+static void config_store(void)
+{
+	int err;
+	const struct config_stored stored = {
+		.version = CONFIG_STORED_VERSION,
+		.led = led_applied,
+		.config = config_applied,
+		.env_config = env_config_applied,
+		.led_timestamp = led_applied_timestamp,
+		.config_timestamp = config_applied_timestamp,
+		.env_config_timestamp = env_config_applied_timestamp,
+	};
+
+	err = settings_save_one(CONFIG_STORED_SETTINGS_KEY "/" CONFIG_STORED_SETTINGS_NAME,
+				&stored, sizeof(stored));
+	if (err) {
+		LOG_ERR("settings_save_one, error: %d", err);
+	}
+}
+
+/* Publish the configuration stored at the last run, so that modules use it from boot instead
+ * of waiting for the first shadow request after the cloud connection is established. The
+ * stored object timestamps make sure that only newer objects from the shadow are applied.
+ */
+static int config_restore(void)
+{
+	int err;
+
+	err = settings_subsys_init();
+	if (err) {
+		LOG_ERR("settings_subsys_init, error: %d", err);
+		return 0;
+	}
+
+	err = settings_load_subtree(CONFIG_STORED_SETTINGS_KEY);
+	if (err) {
+		LOG_ERR("settings_load_subtree, error: %d", err);
+		return 0;
+	}
+
+	/* Objects that have never been applied have no timestamp */
+	if (led_applied_timestamp) {
+		LOG_DBG("Publishing stored LED configuration");
+
+		err = zbus_chan_pub(&LED_CONFIG_CHAN, &led_applied, K_NO_WAIT);
+		if (err) {
+			LOG_ERR("zbus_chan_pub, error: %d", err);
+		}
+	}
+
+	if (config_applied_timestamp) {
+		LOG_DBG("Publishing stored application configuration");
+
+		err = zbus_chan_pub(&APP_CONFIG_CHAN, &config_applied, K_NO_WAIT);
+		if (err) {
+			LOG_ERR("zbus_chan_pub, error: %d", err);
+		}
+	}
+
+	if (env_config_applied_timestamp) {
+		LOG_DBG("Publishing stored environmental configuration");
+
+		err = zbus_chan_pub(&ENV_CONFIG_CHAN, &env_config_applied, K_NO_WAIT);
+		if (err) {
+			LOG_ERR("zbus_chan_pub, error: %d", err);
+		}
+	}
+
+	return 0;
+}
+
+SYS_INIT(config_restore, APPLICATION, CONFIG_APP_CONFIG_PERSIST_INIT_PRIORITY);
+
+#endif /* CONFIG_APP_CONFIG_PERSIST */
+
+/* Buffer that the shadow is received into. Kept off the app thread stack, as its size limits
+ * the size of shadow that can be handled.
+ */
+static uint8_t buf_cbor[CONFIG_APP_MODULE_RECV_BUFFER_SIZE];
+
+/* Length of the reported state that acknowledges the last applied configuration. The report is
+ * kept in buf_cbor until it is sent, together with the next uplink, after at most
+ * CONFIG_APP_REPORT_DELAY_MAX_SECONDS, or before the buffer is reused for a shadow request.
+ */
+static size_t report_len;
+static atomic_t report_pending;
+
+/* Objects applied since the last report was sent, which the pending report acknowledges */
+enum report_object {
+	REPORT_OBJ_LED = BIT(0),
+	REPORT_OBJ_CONFIG = BIT(1),
+	REPORT_OBJ_ENV_CONFIG = BIT(2),
+};
+
+static uint32_t report_objects;
+
+/* Safe to call from any context */
+static void shadow_request(enum shadow_request request)
+{
+	atomic_or(&shadow_requests, request);
+	(void)k_work_submit_to_queue(&shadow_queue, &shadow_work);
+}
+
+static void report_timeout_work_fn(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	LOG_DBG("Reported state delay expired");
+
+	shadow_request(SHADOW_REQ_REPORT);
+}
+
+static K_WORK_DELAYABLE_DEFINE(report_timeout_work, report_timeout_work_fn);
+
+/* Called in the context of the publisher when data is about to be sent to cloud. The radio is
+ * active at that point, send the pending report in the same wake window.
+ */
+static void uplink_callback(const struct zbus_channel *chan)
+{
+	ARG_UNUSED(chan);
+
+	if (atomic_get(&report_pending)) {
+		shadow_request(SHADOW_REQ_REPORT);
+	}
+}
+
+ZBUS_LISTENER_DEFINE(app_uplink, uplink_callback);
+ZBUS_CHAN_ADD_OBS(PAYLOAD_CHAN, app_uplink, 0);
+
+static void report_send(void)
+{
+	int err;
 
-#define MAX_MSG_SIZE (MAX(sizeof(enum trigger_type), sizeof(enum cloud_status)))
+	if (!atomic_clear(&report_pending)) {
+		return;
+	}
 
-BUILD_ASSERT(CONFIG_APP_MODULE_WATCHDOG_TIMEOUT_SECONDS > CONFIG_APP_MODULE_EXEC_TIME_SECONDS_MAX,
-	     "Watchdog timeout must be greater than maximum execution time");
+	k_work_cancel_delayable(&report_timeout_work);
 
-static void shadow_get(bool delta_only)
+	/* Send the received configuration back to the reported shadow section. */
+	err = nrf_cloud_coap_patch("state/reported", NULL, buf_cbor, report_len,
+				   COAP_CONTENT_FORMAT_APP_CBOR, true, NULL, NULL);
+	if (err < 0) {
+		LOG_ERR("Failed to send PATCH request: %d", err);
+	} else if (err > 0) {
+		LOG_ERR("Error from server: %d", err);
+	} else {
+		/* Only objects that have been reported are stored, an object that is stored
+		 * with its timestamp is never applied and reported again.
+		 */
+		IF_ENABLED(CONFIG_APP_CONFIG_PERSIST, (config_store();));
+
+		report_objects = 0;
+		return;
+	}
+
+	/* Forget the objects applied with this report, so that they are applied and reported
+	 * again if the shadow still contains them in the next request. Objects that were
+	 * reported before are kept.
+	 */
+	if (report_objects & REPORT_OBJ_LED) {
+		led_applied_timestamp = 0;
+	}
+
+	if (report_objects & REPORT_OBJ_CONFIG) {
+		config_applied_timestamp = 0;
+	}
+
+	if (report_objects & REPORT_OBJ_ENV_CONFIG) {
+		env_config_applied_timestamp = 0;
+	}
+
+	report_objects = 0;
+	shadow_applied_crc = 0;
+}
+
+static void report_queue(size_t len, uint32_t objects, bool immediate)
+{
+	report_len = len;
+	report_objects = objects;
+	atomic_set(&report_pending, 1);
+
+	if (immediate) {
+		report_send();
+		return;
+	}
+
+	k_work_reschedule(&report_timeout_work, K_SECONDS(CONFIG_APP_REPORT_DELAY_MAX_SECONDS));
+}
+
+/* Returns 0 if a configuration was received and applied, -ENODATA if there were no changes,
+ * or another negative error code if the shadow could not be obtained or decoded.
+ */
+static int shadow_get(bool delta_only)
 {
 	int err;
-	struct app_object app_object = { 0 };
-	struct configuration configuration = { 0 };
-	uint8_t buf_cbor[CONFIG_APP_MODULE_RECV_BUFFER_SIZE] = { 0 };
+	struct shadow_objects objects;
+	struct led_configuration led_config = { 0 };
+	struct app_configuration app_config = { 0 };
+	struct env_configuration env_config = { 0 };
 	size_t buf_cbor_len = sizeof(buf_cbor);
-	size_t not_used;
+	uint32_t crc;
+	bool led_changed;
+	bool config_changed;
+	bool env_config_changed;
+
+	/* The pending report is stored in the receive buffer, send it before the buffer is
+	 * reused.
+	 */
+	report_send();
 
 	LOG_DBG("Requesting device configuration from the device shadow");
 
+	/* Cleared for the empty buffer workaround below */
+	memset(buf_cbor, 0, sizeof(buf_cbor));
+
 	err = nrf_cloud_coap_shadow_get(buf_cbor, &buf_cbor_len, delta_only,
 					COAP_CONTENT_FORMAT_APP_CBOR);
 	if (err == -EACCES) {
 		LOG_WRN("Not connected, error: %d", err);
-		return;
+		return err;
 	} else if (err == -ETIMEDOUT) {
 		LOG_WRN("Request timed out, error: %d", err);
-		return;
+		return err;
 	} else if (err > 0) {
 		LOG_WRN("Cloud error: %d", err);
 
 		IF_ENABLED(CONFIG_MEMFAULT,
 			(MEMFAULT_TRACE_EVENT_WITH_STATUS(nrf_cloud_coap_shadow_get, err)));
 
-		return;
+		return -EBADMSG;
 	} else if (err) {
 		LOG_ERR("Failed to request shadow delta: %d", err);
-		return;
+		return err;
 	}
 
 	if (buf_cbor_len == 0) {
 		LOG_DBG("No shadow delta changes available");
-		return;
+		return -ENODATA;
 	}
 
 	/* Workaroud: Sometimes nrf_cloud_coap_shadow_get() returns 0 even though obtaining
@@ -75,10 +529,19 @@ static void shadow_get(bool delta_only)
 	 */
 	if (!memcmp(buf_cbor, "\0\0\0\0\0\0\0\0\0\0", 10)) {
 		LOG_WRN("Returned buffer is empty, ignore");
-		return;
+		return -ENODATA;
+	}
+
+	/* The same document is returned until the reported state matches the desired state,
+	 * there is no need to decode it again if it has already been handled.
+	 */
+	crc = crc32_ieee(buf_cbor, buf_cbor_len);
+	if (crc == shadow_applied_crc) {
+		LOG_DBG("Shadow unchanged since last request, ignoring");
+		return -ENODATA;
 	}
 
-	err = cbor_decode_app_object(buf_cbor, buf_cbor_len, &app_object, &not_used);
+	err = shadow_decode(buf_cbor, buf_cbor_len, &objects);
 	if (err) {
 		/* Do not throw an error if decoding fails. This might occur if the shadow
  		 * structure or content changes. In such cases, we need to ensure the possibility
@@ -89,95 +552,310 @@ static void shadow_get(bool delta_only)
 		LOG_HEXDUMP_ERR(buf_cbor, buf_cbor_len, "CBOR data");
 
 		IF_ENABLED(CONFIG_MEMFAULT,
-			(MEMFAULT_TRACE_EVENT_WITH_STATUS(cbor_decode_app_object, err)));
+			(MEMFAULT_TRACE_EVENT_WITH_STATUS(shadow_decode, err)));
 
-		return;
+		return -EBADMSG;
 	}
 
-	if (!app_object.lwm2m_present) {
+	if (!objects.led_present && !objects.config_present && !objects.env_config_present) {
 		LOG_DBG("No LwM2M object present in shadow, ignoring");
-		return;
+		return -ENODATA;
 	}
 
-	if (app_object.lwm2m.lwm2m._1424010_present) {
-		configuration.led_present = true;
+	/* Objects with the same timestamp as the last applied instance are unchanged */
+	led_changed = objects.led_present && (objects.led._0._99 != led_applied_timestamp);
+	config_changed = objects.config_present &&
+			 (objects.config._0._99 != config_applied_timestamp);
+	env_config_changed = objects.env_config_present &&
+			     (objects.env_config._0._99 != env_config_applied_timestamp);
+
+	if (!led_changed && !config_changed && !env_config_changed) {
+		LOG_DBG("No changed objects in shadow, ignoring");
+		shadow_applied_crc = crc;
+		return -ENODATA;
+	}
 
-		configuration.led_red = app_object.lwm2m.lwm2m._1424010._1424010._0._0._0;
-		configuration.led_red_present =
-			app_object.lwm2m.lwm2m._1424010._1424010._0._0_present;
+	if (led_changed) {
+		led_config.red = objects.led._0._0._0;
+		led_config.red_present = objects.led._0._0_present;
 
-		configuration.led_green = app_object.lwm2m.lwm2m._1424010._1424010._0._1._1;
-		configuration.led_green_present =
-			app_object.lwm2m.lwm2m._1424010._1424010._0._1_present;
+		led_config.green = objects.led._0._1._1;
+		led_config.green_present = objects.led._0._1_present;
 
-		configuration.led_blue = app_object.lwm2m.lwm2m._1424010._1424010._0._2._2;
-		configuration.led_blue_present =
-			app_object.lwm2m.lwm2m._1424010._1424010._0._2_present;
+		led_config.blue = objects.led._0._2._2;
+		led_config.blue_present = objects.led._0._2_present;
 
 		LOG_DBG("LED object (1424010) values received from cloud:");
 
-		if (configuration.led_red_present) {
-			LOG_DBG("New RED value: %d", configuration.led_red);
+		if (led_config.red_present) {
+			LOG_DBG("New RED value: %d", led_config.red);
 		}
 
-		if (configuration.led_green_present) {
-			LOG_DBG("New GREEN value: %d", configuration.led_green);
+		if (led_config.green_present) {
+			LOG_DBG("New GREEN value: %d", led_config.green);
 		}
 
-		if (configuration.led_blue_present) {
-			LOG_DBG("New BLUE value: %d", configuration.led_blue);
+		if (led_config.blue_present) {
+			LOG_DBG("New BLUE value: %d", led_config.blue);
 		}
 
-		LOG_DBG("Timestamp: %lld", app_object.lwm2m.lwm2m._1424010._1424010._0._99);
+		LOG_DBG("Timestamp: %lld", objects.led._0._99);
 	}
 
-	if (app_object.lwm2m.lwm2m._1430110_present) {
-		configuration.config_present = true;
+	if (config_changed) {
+		app_config.update_interval = objects.config._0._0._0;
+		app_config.update_interval_present = objects.config._0._0_present;
+
+		app_config.gnss = objects.config._0._1._1;
+		app_config.gnss_present = objects.config._0._1_present;
+
+		app_config.frequent_poll_duration_present =
+			policy_value_get(objects.config._0._2_present, objects.config._0._2._2,
+					 POLICY_FREQUENT_POLL_DURATION_MAX_SEC,
+					 &app_config.frequent_poll_duration);
+		app_config.frequent_poll_interval_present =
+			policy_value_get(objects.config._0._3_present, objects.config._0._3._3,
+					 POLICY_FREQUENT_POLL_INTERVAL_MAX_SEC,
+					 &app_config.frequent_poll_interval);
+		app_config.reconnection_timeout_present =
+			policy_value_get(objects.config._0._4_present, objects.config._0._4._4,
+					 POLICY_RECONNECTION_TIMEOUT_MAX_SEC,
+					 &app_config.reconnection_timeout);
+		app_config.location_timeout_present =
+			policy_value_get(objects.config._0._5_present, objects.config._0._5._5,
+					 POLICY_LOCATION_TIMEOUT_MAX_SEC,
+					 &app_config.location_timeout);
 
-		configuration.update_interval = app_object.lwm2m.lwm2m._1430110._1430110._0._0._0;
-		configuration.update_interval_present =
-			app_object.lwm2m.lwm2m._1430110._1430110._0._0_present;
+		LOG_DBG("Application configuration object (1430110) values received from cloud:");
 
-		configuration.gnss = app_object.lwm2m.lwm2m._1430110._1430110._0._1._1;
-		configuration.gnss_present = app_object.lwm2m.lwm2m._1430110._1430110._0._1_present;
+		if (app_config.update_interval_present) {
+			LOG_DBG("New update interval: %lld", app_config.update_interval);
+		}
 
-		LOG_DBG("Application configuration object (1430110) values received from cloud:");
+		if (app_config.gnss_present) {
+			LOG_DBG("New GNSS setting: %d", app_config.gnss);
+		}
+
+		if (app_config.frequent_poll_duration_present) {
+			LOG_DBG("New frequent poll duration: %d",
+				app_config.frequent_poll_duration);
+		}
 
-		if (configuration.update_interval_present) {
-			LOG_DBG("New update interval: %lld", configuration.update_interval);
+		if (app_config.frequent_poll_interval_present) {
+			LOG_DBG("New frequent poll interval: %d",
+				app_config.frequent_poll_interval);
 		}
 
-		if (configuration.gnss_present) {
-			LOG_DBG("New GNSS setting: %d", configuration.gnss);
+		if (app_config.reconnection_timeout_present) {
+			LOG_DBG("New reconnection timeout: %d", app_config.reconnection_timeout);
 		}
 
-		LOG_DBG("Timestamp: %lld", app_object.lwm2m.lwm2m._1430110._1430110._0._99);
+		if (app_config.location_timeout_present) {
+			LOG_DBG("New location timeout: %d", app_config.location_timeout);
+		}
+
+		LOG_DBG("Timestamp: %lld", objects.config._0._99);
 	}
 
-	/* Distribute configuration */
-	err = zbus_chan_pub(&CONFIG_CHAN, &configuration, K_SECONDS(1));
-	if (err) {
-		LOG_ERR("zbus_chan_pub, error: %d", err);
-		SEND_FATAL_ERROR();
+	if (env_config_changed) {
+		env_config.temperature.absolute_present =
+			deadband_value_get(objects.env_config._0._0_present,
+					   objects.env_config._0._0._0,
+					   &env_config.temperature.absolute);
+		env_config.humidity.absolute_present =
+			deadband_value_get(objects.env_config._0._1_present,
+					   objects.env_config._0._1._1,
+					   &env_config.humidity.absolute);
+		env_config.pressure.absolute_present =
+			deadband_value_get(objects.env_config._0._2_present,
+					   objects.env_config._0._2._2,
+					   &env_config.pressure.absolute);
+		env_config.iaq.absolute_present =
+			deadband_value_get(objects.env_config._0._3_present,
+					   objects.env_config._0._3._3,
+					   &env_config.iaq.absolute);
+		env_config.temperature.relative_present =
+			deadband_value_get(objects.env_config._0._4_present,
+					   objects.env_config._0._4._4,
+					   &env_config.temperature.relative);
+		env_config.humidity.relative_present =
+			deadband_value_get(objects.env_config._0._5_present,
+					   objects.env_config._0._5._5,
+					   &env_config.humidity.relative);
+		env_config.pressure.relative_present =
+			deadband_value_get(objects.env_config._0._6_present,
+					   objects.env_config._0._6._6,
+					   &env_config.pressure.relative);
+		env_config.iaq.relative_present =
+			deadband_value_get(objects.env_config._0._7_present,
+					   objects.env_config._0._7._7,
+					   &env_config.iaq.relative);
+
+		/* The heartbeat is a number of intervals, 0 is not valid */
+		env_config.heartbeat_present =
+			policy_value_get(objects.env_config._0._8_present,
+					 objects.env_config._0._8._8,
+					 ENV_HEARTBEAT_INTERVALS_MAX, &env_config.heartbeat);
+
+		/* A mask of 0 disables the environmental reports */
+		if (objects.env_config._0._9_present) {
+			env_config.resources = objects.env_config._0._9._9;
+			env_config.resources_present = true;
+		}
+
+		env_config.sample_interval_min_present =
+			policy_value_get(objects.env_config._0._10_present,
+					 objects.env_config._0._10._10,
+					 POLICY_SAMPLE_INTERVAL_MAX_SEC,
+					 &env_config.sample_interval_min);
+		env_config.sample_interval_max_present =
+			policy_value_get(objects.env_config._0._11_present,
+					 objects.env_config._0._11._11,
+					 POLICY_SAMPLE_INTERVAL_MAX_SEC,
+					 &env_config.sample_interval_max);
+
+		LOG_DBG("Environmental configuration object (1430210) values received from cloud:");
+
+		if (env_config.heartbeat_present) {
+			LOG_DBG("New heartbeat: %d intervals", env_config.heartbeat);
+		}
+
+		if (env_config.resources_present) {
+			LOG_DBG("New resources mask: 0x%x", env_config.resources);
+		}
+
+		if (env_config.sample_interval_min_present) {
+			LOG_DBG("New shortest local sampling interval: %u",
+				env_config.sample_interval_min);
+		}
+
+		if (env_config.sample_interval_max_present) {
+			LOG_DBG("New longest local sampling interval: %u",
+				env_config.sample_interval_max);
+		}
+
+		LOG_DBG("Timestamp: %lld", objects.env_config._0._99);
+	}
+
+	/* Distribute the changed objects */
+	if (led_changed) {
+		err = zbus_chan_pub(&LED_CONFIG_CHAN, &led_config, K_SECONDS(1));
+		if (err) {
+			LOG_ERR("zbus_chan_pub, error: %d", err);
+			SEND_FATAL_ERROR();
+			return err;
+		}
+
+		led_applied_timestamp = objects.led._0._99;
+		led_config_merge(&led_applied, &led_config);
+	}
+
+	if (config_changed) {
+		err = zbus_chan_pub(&APP_CONFIG_CHAN, &app_config, K_SECONDS(1));
+		if (err) {
+			LOG_ERR("zbus_chan_pub, error: %d", err);
+			SEND_FATAL_ERROR();
+			return err;
+		}
+
+		config_applied_timestamp = objects.config._0._99;
+		app_config_merge(&config_applied, &app_config);
+	}
+
+	if (env_config_changed) {
+		err = zbus_chan_pub(&ENV_CONFIG_CHAN, &env_config, K_SECONDS(1));
+		if (err) {
+			LOG_ERR("zbus_chan_pub, error: %d", err);
+			SEND_FATAL_ERROR();
+			return err;
+		}
+
+		env_config_applied_timestamp = objects.env_config._0._99;
+		env_config_merge(&env_config_applied, &env_config);
+	}
+
+	shadow_applied_crc = crc;
+
+	/* LED color changes are visible to the user, acknowledge them without delay if
+	 * configured to do so.
+	 */
+	report_queue(buf_cbor_len,
+		     (led_changed ? REPORT_OBJ_LED : 0) |
+		     (config_changed ? REPORT_OBJ_CONFIG : 0) |
+		     (env_config_changed ? REPORT_OBJ_ENV_CONFIG : 0),
+		     led_changed && IS_ENABLED(CONFIG_APP_REPORT_LED_IMMEDIATE));
+
+	return 0;
+}
+
+static void shadow_poll_backoff_reset(void)
+{
+	shadow_poll_interval_sec = CONFIG_APP_SHADOW_POLL_INTERVAL_MIN_SECONDS;
+	shadow_polled = false;
+}
+
+/* Request the shadow delta if the current poll interval has passed since the last request */
+static void shadow_poll(void)
+{
+	int err;
+	int64_t now = k_uptime_get();
+
+	if (shadow_polled &&
+	    ((now - shadow_poll_last_ms + SHADOW_POLL_SLACK_MS) <
+	     ((int64_t)shadow_poll_interval_sec * MSEC_PER_SEC))) {
+		LOG_DBG("Shadow poll skipped, interval: %d seconds", shadow_poll_interval_sec);
 		return;
 	}
 
-	/* Send the received configuration back to the reported shadow section. */
-	err = nrf_cloud_coap_patch("state/reported", NULL, (uint8_t *)buf_cbor,
-				   buf_cbor_len, COAP_CONTENT_FORMAT_APP_CBOR, true, NULL, NULL);
-	if (err < 0) {
-		LOG_ERR("Failed to send PATCH request: %d", err);
-	} else if (err > 0) {
-		LOG_ERR("Error from server: %d", err);
+	shadow_polled = true;
+	shadow_poll_last_ms = now;
+
+	err = shadow_get(true);
+	if (err == -ENODATA) {
+		shadow_poll_interval_sec = MIN(shadow_poll_interval_sec * 2,
+					       CONFIG_APP_SHADOW_POLL_INTERVAL_MAX_SECONDS);
+
+		LOG_DBG("Shadow poll interval: %d seconds", shadow_poll_interval_sec);
+	} else if (err == 0) {
+		shadow_poll_interval_sec = CONFIG_APP_SHADOW_POLL_INTERVAL_MIN_SECONDS;
 	}
 }
 
-static void task_wdt_callback(int channel_id, void *user_data)
+/* Handles the shadow requests issued since the last run. Runs in the shadow workqueue, which
+ * owns the shadow state, the receive buffer and the poll backoff.
+ */
+static void shadow_work_fn(struct k_work *work)
 {
-	LOG_ERR("Watchdog expired, Channel: %d, Thread: %s",
-		channel_id, k_thread_name_get((k_tid_t)user_data));
+	atomic_val_t requests = atomic_clear(&shadow_requests);
+
+	ARG_UNUSED(work);
+
+	supervisor_checkin(shadow_supervisor_id);
+	MODULE_TRACE_WORK_BEGIN();
+
+	if (requests & SHADOW_REQ_BACKOFF_RESET) {
+		shadow_poll_backoff_reset();
+	}
+
+	if (requests & SHADOW_REQ_FULL) {
+		/* The full shadow request counts as a poll, so that the poll trigger sent on
+		 * connection does not request the delta right after it.
+		 */
+		shadow_poll_backoff_reset();
+		shadow_polled = true;
+		shadow_poll_last_ms = k_uptime_get();
+
+		(void)shadow_get(false);
+	} else if (requests & SHADOW_REQ_POLL) {
+		shadow_poll();
+	}
+
+	if (requests & SHADOW_REQ_REPORT) {
+		report_send();
+	}
 
-	SEND_FATAL_ERROR_WATCHDOG_TIMEOUT();
+	MODULE_TRACE_WORK_END();
+	supervisor_checkout(shadow_supervisor_id);
 }
 
 static void date_time_handler(const struct date_time_evt *evt) {
@@ -197,37 +875,51 @@ static void app_task(void)
 {
 	int err;
 	const struct zbus_channel *chan = NULL;
-	int task_wdt_id;
+	int supervisor_id;
 	const uint32_t wdt_timeout_ms = (CONFIG_APP_MODULE_WATCHDOG_TIMEOUT_SECONDS * MSEC_PER_SEC);
-	const uint32_t execution_time_ms = (CONFIG_APP_MODULE_EXEC_TIME_SECONDS_MAX * MSEC_PER_SEC);
-	const k_timeout_t zbus_wait_ms = K_MSEC(wdt_timeout_ms - execution_time_ms);
 	uint8_t msg_buf[MAX_MSG_SIZE];
 
 	LOG_DBG("Application module task started");
 
-	task_wdt_id = task_wdt_add(wdt_timeout_ms, task_wdt_callback, (void *)k_current_get());
+	supervisor_id = supervisor_add(&app, wdt_timeout_ms);
+	if (supervisor_id < 0) {
+		LOG_ERR("supervisor_add, error: %d", supervisor_id);
+		SEND_FATAL_ERROR();
+		return;
+	}
+
+	k_work_queue_init(&shadow_queue);
+	k_work_queue_start(&shadow_queue, shadow_stack_area,
+			   K_THREAD_STACK_SIZEOF(shadow_stack_area),
+			   CONFIG_APP_THREAD_PRIORITY_NORMAL,
+			   NULL);
+	k_thread_name_set(&shadow_queue.thread, "app_shadow_workq");
+
+	/* A shadow request that hangs stalls all shadow handling, the queue is supervised with
+	 * the same timeout as the module thread, well above the CoAP request timeout.
+	 */
+	shadow_supervisor_id = supervisor_add_work_queue(&shadow_queue, wdt_timeout_ms);
+	if (shadow_supervisor_id < 0) {
+		LOG_ERR("supervisor_add_work_queue, error: %d", shadow_supervisor_id);
+		SEND_FATAL_ERROR();
+		return;
+	}
 
 	/* Setup handler for date_time library */
 	date_time_register_handler(date_time_handler);
 
 	while (true) {
-		err = task_wdt_feed(task_wdt_id);
+		err = zbus_sub_wait_msg(&app, &chan, &msg_buf, K_FOREVER);
 		if (err) {
-			LOG_ERR("task_wdt_feed, error: %d", err);
-			SEND_FATAL_ERROR();
-			return;
-		}
-
-		err = zbus_sub_wait_msg(&app, &chan, &msg_buf, zbus_wait_ms);
-		if (err == -ENOMSG) {
-			continue;
-		} else if (err) {
 			LOG_ERR("zbus_sub_wait, error: %d", err);
 			SEND_FATAL_ERROR();
 			return;
 		}
 
-		if (&CLOUD_CHAN == chan) {
+		supervisor_checkin(supervisor_id);
+
+		switch (CHAN_ID(chan)) {
+		case CHAN_ID_CLOUD_CHAN: {
 			LOG_DBG("Cloud connection status received");
 
 			const enum cloud_status *status = (const enum cloud_status *)msg_buf;
@@ -235,11 +927,19 @@ static void app_task(void)
 			if (*status == CLOUD_CONNECTED_READY_TO_SEND) {
 				LOG_DBG("Cloud ready to send");
 
-				shadow_get(false);
+				shadow_request(SHADOW_REQ_FULL);
+			} else if (*status == CLOUD_DISCONNECTED) {
+				LOG_DBG("Cloud disconnected, cancelling pending shadow requests");
+
+				/* A request that is already in progress fails or times out in the
+				 * CoAP client, the pending report is kept until reconnected.
+				 */
+				atomic_and(&shadow_requests, ~SHADOW_REQ_CLOUD);
 			}
-		}
 
-		if (&TRIGGER_CHAN == chan) {
+			break;
+		}
+		case CHAN_ID_TRIGGER_CHAN: {
 			LOG_DBG("Trigger received");
 
 			const enum trigger_type *type = (const enum trigger_type *)msg_buf;
@@ -247,21 +947,27 @@ static void app_task(void)
 			if (*type == TRIGGER_POLL) {
 				LOG_DBG("Poll trigger received");
 
-				shadow_get(true);
+				shadow_request(SHADOW_REQ_POLL);
 			}
+
+			break;
+		}
+		case CHAN_ID_BUTTON_CHAN:
+			/* The user is likely to change the configuration from the cloud side after
+			 * interacting with the device, poll at the highest rate again.
+			 */
+			LOG_DBG("Button press received, resetting shadow poll interval");
+
+			shadow_request(SHADOW_REQ_BACKOFF_RESET);
+			break;
+		default:
+			break;
 		}
+
+		supervisor_checkout(supervisor_id);
 	}
 }
 
 K_THREAD_DEFINE(app_task_id,
 		CONFIG_APP_MODULE_THREAD_STACK_SIZE,
-		app_task, NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
-
-static int watchdog_init(void)
-{
-	__ASSERT((task_wdt_init(NULL) == 0), "Task watchdog init failure");
-
-	return 0;
-}
-
-SYS_INIT(watchdog_init, POST_KERNEL, CONFIG_APPLICATION_INIT_PRIORITY);
+		app_task, NULL, NULL, NULL, CONFIG_APP_THREAD_PRIORITY_NORMAL, 0, 0);
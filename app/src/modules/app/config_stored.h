@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**@file
+ *
+ * @brief   Applied configuration as stored in settings by the app module.
+ */
+
+#ifndef CONFIG_STORED_H__
+#define CONFIG_STORED_H__
+
+#include <zephyr/kernel.h>
+#include "message_channel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Settings key and name under which the applied configuration is stored. */
+#define CONFIG_STORED_SETTINGS_KEY	"app"
+#define CONFIG_STORED_SETTINGS_NAME	"config"
+
+/** @brief Version of struct config_stored. Must be incremented whenever the layout of the
+ *	   structure or of the configuration structures it contains changes.
+ */
+#define CONFIG_STORED_VERSION		1
+
+/** @brief Applied objects and their timestamps as stored in settings. */
+struct config_stored {
+	/* CONFIG_STORED_VERSION when the record was stored */
+	uint32_t version;
+
+	struct led_configuration led;
+	struct app_configuration config;
+	struct env_configuration env_config;
+	int64_t led_timestamp;
+	int64_t config_timestamp;
+	int64_t env_config_timestamp;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_STORED_H__ */
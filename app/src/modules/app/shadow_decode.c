@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zcbor_decode.h>
+
+#include "shadow_decode.h"
+
+LOG_MODULE_DECLARE(app, CONFIG_APP_LOG_LEVEL);
+
+#define LWM2M_KEY	"lwm2m"
+#define LED_KEY		"14240:1.0"
+#define CONFIG_KEY	"14301:1.0"
+#define ENV_CONFIG_KEY	"14302:1.0"
+
+/* Maps entered by the decoder, the shadow itself and the lwm2m map. Objects are decoded with
+ * their own state.
+ */
+#define MAP_DEPTH_MAX 2
+
+static bool key_equals(const struct zcbor_string *key, const char *str)
+{
+	size_t len = strlen(str);
+
+	return (key->len == len) && (memcmp(key->value, str, len) == 0);
+}
+
+/* Decode the key of the next map entry. Keys that are not text strings are skipped and
+ * returned as an empty key, so that the entry is ignored.
+ */
+static bool key_decode(zcbor_state_t *state, struct zcbor_string *key)
+{
+	if ((state->payload < state->payload_end) &&
+	    (ZCBOR_MAJOR_TYPE(*state->payload) == ZCBOR_MAJOR_TYPE_TSTR)) {
+		return zcbor_tstr_decode(state, key);
+	}
+
+	key->value = NULL;
+	key->len = 0;
+
+	return zcbor_any_skip(state, NULL);
+}
+
+static int lwm2m_decode(zcbor_state_t *state, struct shadow_objects *objects)
+{
+	int err;
+	struct zcbor_string key;
+	const uint8_t *value;
+	size_t value_len;
+	size_t not_used;
+
+	if (!zcbor_map_start_decode(state)) {
+		return -EBADMSG;
+	}
+
+	while (!zcbor_array_at_end(state)) {
+		if (!key_decode(state, &key)) {
+			return -EBADMSG;
+		}
+
+		/* Skip the value to find its extent, only objects of interest are decoded */
+		value = state->payload;
+
+		if (!zcbor_any_skip(state, NULL)) {
+			return -EBADMSG;
+		}
+
+		value_len = state->payload - value;
+
+		if (key_equals(&key, LED_KEY)) {
+			err = cbor_decode_led(value, value_len, &objects->led, &not_used);
+			if (err) {
+				LOG_ERR("cbor_decode_led, error: %d", err);
+				return -EBADMSG;
+			}
+
+			objects->led_present = true;
+		} else if (key_equals(&key, CONFIG_KEY)) {
+			err = cbor_decode_config(value, value_len, &objects->config, &not_used);
+			if (err) {
+				LOG_ERR("cbor_decode_config, error: %d", err);
+				return -EBADMSG;
+			}
+
+			objects->config_present = true;
+		} else if (key_equals(&key, ENV_CONFIG_KEY)) {
+			err = cbor_decode_env_config(value, value_len, &objects->env_config,
+						     &not_used);
+			if (err) {
+				LOG_ERR("cbor_decode_env_config, error: %d", err);
+				return -EBADMSG;
+			}
+
+			objects->env_config_present = true;
+		}
+	}
+
+	if (!zcbor_map_end_decode(state)) {
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+int shadow_decode(const uint8_t *payload, size_t payload_len, struct shadow_objects *objects)
+{
+	int err;
+	struct zcbor_string key;
+
+	ZCBOR_STATE_D(state, MAP_DEPTH_MAX, payload, payload_len, 1, 0);
+
+	memset(objects, 0, sizeof(*objects));
+
+	if (!zcbor_map_start_decode(state)) {
+		return -EBADMSG;
+	}
+
+	while (!zcbor_array_at_end(state)) {
+		if (!key_decode(state, &key)) {
+			return -EBADMSG;
+		}
+
+		if (key_equals(&key, LWM2M_KEY)) {
+			err = lwm2m_decode(state, objects);
+			if (err) {
+				return err;
+			}
+		} else if (!zcbor_any_skip(state, NULL)) {
+			return -EBADMSG;
+		}
+	}
+
+	if (!zcbor_map_end_decode(state)) {
+		return -EBADMSG;
+	}
+
+	return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**@file
+ *
+ * @brief   Device shadow decoding.
+ */
+
+#ifndef SHADOW_DECODE_H__
+#define SHADOW_DECODE_H__
+
+#include <zephyr/kernel.h>
+#include "app_object_decode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief LwM2M objects extracted from the device shadow. */
+struct shadow_objects {
+	/* LED object, 14240:1.0 */
+	struct led led;
+	bool led_present;
+
+	/* Application configuration object, 14301:1.0 */
+	struct config config;
+	bool config_present;
+
+	/* Environmental configuration object, 14302:1.0 */
+	struct env_config env_config;
+	bool env_config_present;
+};
+
+/** @brief Extract the LwM2M objects used by the application from a CBOR encoded shadow.
+ *
+ *  @note The shadow is walked without being fully decoded. Entries other than the LwM2M
+ *	  objects used by the application are skipped without being validated, and only the
+ *	  extracted objects are decoded using the decoders generated from app_object.cddl.
+ *
+ *  @param payload CBOR encoded shadow.
+ *  @param payload_len Length of the shadow.
+ *  @param objects Pointer to where the extracted objects are stored.
+ *
+ *  @return 0 on success, -EBADMSG if the shadow or one of the objects could not be decoded.
+ */
+int shadow_decode(const uint8_t *payload, size_t payload_len, struct shadow_objects *objects);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHADOW_DECODE_H__ */
@@ -11,13 +11,13 @@
 #include <zephyr/sys/util.h>
 #include <nrf_fuel_gauge.h>
 #include <date_time.h>
-#include <math.h>
-#include <zephyr/task_wdt/task_wdt.h>
 #include <zephyr/smf.h>
 
 #include "lp803448_model.h"
 #include "message_channel.h"
 #include "modules_common.h"
+#include "supervisor.h"
+#include "pending_samples.h"
 #include "bat_object_encode.h"
 
 /* Register log module */
@@ -27,17 +27,11 @@ LOG_MODULE_REGISTER(battery, CONFIG_APP_BATTERY_LOG_LEVEL);
 ZBUS_MSG_SUBSCRIBER_DEFINE(battery);
 
 /* Observe channels */
-ZBUS_CHAN_ADD_OBS(TRIGGER_CHAN, battery, 0);
-ZBUS_CHAN_ADD_OBS(NETWORK_CHAN, battery, 0);
-ZBUS_CHAN_ADD_OBS(TIME_CHAN, battery, 0);
+#define CHANNELS TRIGGER_CHAN, NETWORK_CHAN, TIME_CHAN
 
-#define MAX_MSG_SIZE \
-	(MAX(sizeof(enum trigger_type), \
-		(MAX(sizeof(enum network_status), sizeof(enum time_status)))))
+CHAN_ADD_OBS(battery, CHANNELS);
 
-BUILD_ASSERT(CONFIG_APP_BATTERY_WATCHDOG_TIMEOUT_SECONDS >
-			CONFIG_APP_BATTERY_EXEC_TIME_SECONDS_MAX,
-			"Watchdog timeout must be greater than maximum execution time");
+#define MAX_MSG_SIZE CHAN_MSG_SIZE_MAX(CHANNELS)
 
 /* nPM1300 register bitmasks */
 
@@ -50,19 +44,66 @@ BUILD_ASSERT(CONFIG_APP_BATTERY_WATCHDOG_TIMEOUT_SECONDS >
 
 static const struct device *charger = DEVICE_DT_GET(DT_NODELABEL(npm1300_charger));
 
+/* Battery values of a sample */
+struct bat_sample {
+	float voltage;
+	float current;
+	float temperature;
+	float state_of_charge;
+	bool charging;
+};
+
+/* Samples taken before time was available */
+PENDING_SAMPLES_DEFINE(battery_pending, struct bat_sample);
+
+/* Latest fuel gauge update, encoded when a sample is sent */
+static struct bat_sample latest;
+static bool latest_valid;
+
+/* Enumerator to be used in private battery channel */
+enum priv_battery_evt {
+	/* Time to update the fuel gauge */
+	BATTERY_PRIV_FUEL_GAUGE_UPDATE,
+};
+
+/* Private channel used to signal when a fuel gauge update is due */
+ZBUS_CHAN_DECLARE(PRIV_BATTERY_CHAN);
+ZBUS_CHAN_DEFINE(PRIV_BATTERY_CHAN,
+		 enum priv_battery_evt,
+		 NULL,
+		 NULL,
+		 ZBUS_OBSERVERS(battery),
+		 ZBUS_MSG_INIT(0)
+);
+
+#if defined(CONFIG_APP_MODULE_TRACE)
+ZBUS_CHAN_ADD_OBS(PRIV_BATTERY_CHAN, module_trace, 0);
+#endif
+
+/* Timer used to update the fuel gauge between data sample triggers */
+static void fuel_gauge_timer_handler(struct k_timer *timer_id);
+static K_TIMER_DEFINE(fuel_gauge_timer, fuel_gauge_timer_handler, NULL);
+
 /* Forward declarations */
 static struct s_object s_obj;
 static int charger_read_sensors(float *voltage, float *current, float *temp, int32_t *chg_status);
+static void fuel_gauge_update(int64_t *ref_time);
 static void sample(int64_t *ref_time);
+static void sample_pending(int64_t *ref_time);
+static void pending_flush(void);
 
 /* State machine */
 
 /* Defininig the module states.
  *
- * STATE_INIT: The battery module is initializing and waiting for time to be available.
- * STATE_SAMPLING: The battery module is ready to sample upon receiving a trigger.
+ * STATE_RUNNING: The battery module is running, the fuel gauge is updated periodically in
+ *		  any state.
+ *	STATE_INIT: The battery module is waiting for time to be available. Samples are
+ *		    kept with their uptime until then.
+ *	STATE_SAMPLING: The battery module is ready to sample upon receiving a trigger.
  */
 enum battery_module_state {
+	STATE_RUNNING,
 	STATE_INIT,
 	STATE_SAMPLING,
 };
@@ -85,26 +126,34 @@ struct s_object {
 };
 
 /* Forward declarations of state handlers */
-static void state_init_entry(void *o);
+static void state_running_entry(void *o);
+static enum smf_state_result state_running_run(void *o);
 static enum smf_state_result state_init_run(void *o);
+static void state_sampling_entry(void *o);
 static enum smf_state_result state_sampling_run(void *o);
 
 static struct s_object s_obj;
 static const struct smf_state states[] = {
-	[STATE_INIT] =
-		SMF_CREATE_STATE(state_init_entry, state_init_run, NULL,
+	[STATE_RUNNING] =
+		SMF_CREATE_STATE(state_running_entry, state_running_run, NULL,
 				 NULL,	/* No parent state */
+				 &states[STATE_INIT]),
+	[STATE_INIT] =
+		SMF_CREATE_STATE(NULL, state_init_run, NULL,
+				 &states[STATE_RUNNING],
 				 NULL), /* No initial transition */
 	[STATE_SAMPLING] =
-		SMF_CREATE_STATE(NULL, state_sampling_run, NULL,
-				 NULL,
+		SMF_CREATE_STATE(state_sampling_entry, state_sampling_run, NULL,
+				 &states[STATE_RUNNING],
 				 NULL),
 };
 
 /* State handlers */
 
-static void state_init_entry(void *o)
+static void state_running_entry(void *o)
 {
+	const k_timeout_t interval =
+		K_SECONDS(CONFIG_APP_BATTERY_FUEL_GAUGE_UPDATE_INTERVAL_SECONDS);
 	int err;
 	struct sensor_value value;
 	struct nrf_fuel_gauge_init_parameters parameters = {
@@ -141,6 +190,21 @@ static void state_init_entry(void *o)
 		SEND_FATAL_ERROR();
 		return;
 	}
+
+	k_timer_start(&fuel_gauge_timer, interval, interval);
+}
+
+static enum smf_state_result state_running_run(void *o)
+{
+	struct s_object *state_object = o;
+
+	if (&PRIV_BATTERY_CHAN == state_object->chan) {
+		fuel_gauge_update(&state_object->fuel_gauge_ref_time);
+
+		return SMF_EVENT_HANDLED;
+	}
+
+	return SMF_EVENT_PROPAGATE;
 }
 
 static enum smf_state_result state_init_run(void *o)
@@ -158,9 +222,25 @@ static enum smf_state_result state_init_run(void *o)
 		}
 	}
 
+	if (&TRIGGER_CHAN == state_object->chan) {
+		enum trigger_type trigger_type = MSG_TO_TRIGGER_TYPE(state_object->msg_buf);
+
+		if (trigger_type == TRIGGER_DATA_SAMPLE) {
+			LOG_DBG("Data sample trigger received before time is available");
+			sample_pending(&state_object->fuel_gauge_ref_time);
+		}
+	}
+
 	return SMF_EVENT_PROPAGATE;
 }
 
+static void state_sampling_entry(void *o)
+{
+	ARG_UNUSED(o);
+
+	pending_flush();
+}
+
 static enum smf_state_result state_sampling_run(void *o)
 {
 	struct s_object *state_object = o;
@@ -209,65 +289,113 @@ static int charger_read_sensors(float *voltage, float *current, float *temp, int
 #include "memfault/metrics/platform/battery.h"
 #endif /* CONFIG_MEMFAULT_NRF_PLATFORM_BATTERY_NPM13XX */
 
-static void sample(int64_t *ref_time)
+static int bat_sample_get(struct bat_sample *bat_sample, int64_t *ref_time)
 {
 	int err;
 	int chg_status;
-	bool charging;
-	float voltage;
-	float current;
-	float temp;
-	float state_of_charge;
 	float delta;
-	struct bat_object bat_object = { 0 };
-	struct payload payload = { 0 };
-	int64_t system_time;
 #if defined(CONFIG_MEMFAULT_NRF_PLATFORM_BATTERY_NPM13XX)
 	sMfltPlatformBatterySoc soc;
 #endif /* CONFIG_MEMFAULT_NRF_PLATFORM_BATTERY_NPM13XX */
 
-	err = date_time_now(&system_time);
-	if (err) {
-		LOG_ERR("Failed to convert uptime to unix time, error: %d", err);
-		return;
-	}
-
-	err = charger_read_sensors(&voltage, &current, &temp, &chg_status);
+	/* A failed read is not fatal, the update is skipped and the next one integrates over
+	 * both intervals.
+	 */
+	err = charger_read_sensors(&bat_sample->voltage, &bat_sample->current,
+				   &bat_sample->temperature, &chg_status);
 	if (err) {
 		LOG_ERR("charger_read_sensors, error: %d", err);
-		SEND_FATAL_ERROR();
-		return;
+		return err;
 	}
 
 #if defined(CONFIG_MEMFAULT_NRF_PLATFORM_BATTERY_NPM13XX)
 	err = memfault_platform_get_stateofcharge(&soc);
 	if (err) {
 		LOG_ERR("memfault_platform_get_stateofcharge, error: %d", err);
-		SEND_FATAL_ERROR();
-		return;
+		return err;
 	}
 
-	state_of_charge = (float)soc.soc / (float)CONFIG_MEMFAULT_METRICS_BATTERY_SOC_PCT_SCALE_VALUE;
-	charging = soc.discharging;
+	bat_sample->state_of_charge = (float)soc.soc /
+				      (float)CONFIG_MEMFAULT_METRICS_BATTERY_SOC_PCT_SCALE_VALUE;
+	bat_sample->charging = soc.discharging;
 
 	(void)delta;
 #else /* CONFIG_MEMFAULT_NRF_PLATFORM_BATTERY_NPM13XX */
 
 	delta = (float)k_uptime_delta(ref_time) / 1000.f;
 
-	charging = (chg_status & (NPM1300_CHG_STATUS_TC_MASK |
-				  NPM1300_CHG_STATUS_CC_MASK |
-				  NPM1300_CHG_STATUS_CV_MASK)) != 0;
+	bat_sample->charging = (chg_status & (NPM1300_CHG_STATUS_TC_MASK |
+					      NPM1300_CHG_STATUS_CC_MASK |
+					      NPM1300_CHG_STATUS_CV_MASK)) != 0;
 
-	state_of_charge = nrf_fuel_gauge_process(voltage, current, temp, delta, NULL);
+	bat_sample->state_of_charge = nrf_fuel_gauge_process(bat_sample->voltage,
+							     bat_sample->current,
+							     bat_sample->temperature, delta, NULL);
 #endif /* CONFIG_MEMFAULT_NRF_PLATFORM_BATTERY_NPM13XX */
-	LOG_DBG("State of charge: %f", (double)roundf(state_of_charge));
-	LOG_DBG("The battery is %s", charging ? "charging" : "not charging");
+	LOG_DBG("State of charge: %d", (int)(bat_sample->state_of_charge + 0.5f));
+	LOG_DBG("The battery is %s", bat_sample->charging ? "charging" : "not charging");
+
+	return 0;
+}
+
+static void fuel_gauge_timer_handler(struct k_timer *timer_id)
+{
+	ARG_UNUSED(timer_id);
+
+	enum priv_battery_evt evt = BATTERY_PRIV_FUEL_GAUGE_UPDATE;
+	int err;
 
+	/* An update that cannot be queued is skipped, the next one integrates over both */
+	err = zbus_chan_pub(&PRIV_BATTERY_CHAN, &evt, K_NO_WAIT);
+	if (err) {
+		LOG_WRN("Fuel gauge update skipped, zbus_chan_pub, error: %d", err);
+	}
+}
+
+static void fuel_gauge_update(int64_t *ref_time)
+{
+	struct bat_sample bat_sample;
+
+	/* The latest update is kept if this one fails */
+	if (bat_sample_get(&bat_sample, ref_time)) {
+		LOG_WRN("Fuel gauge update skipped");
+		return;
+	}
+
+	latest = bat_sample;
+
+	latest_valid = true;
+}
+
+/* Get the latest fuel gauge update, the fuel gauge is only updated here if it has not been
+ * updated yet.
+ */
+static int latest_get(struct bat_sample *bat_sample, int64_t *ref_time)
+{
+	if (!latest_valid) {
+		fuel_gauge_update(ref_time);
+	}
+
+	if (!latest_valid) {
+		return -ENODATA;
+	}
+
+	*bat_sample = latest;
+
+	return 0;
+}
+
+static void bat_sample_send(const struct bat_sample *bat_sample, int64_t system_time)
+{
+	int err;
+	struct bat_object bat_object = { 0 };
+	struct payload payload = { 0 };
+
+	/* Single precision values are encoded as is, without conversion to double */
 	bat_object.state_of_charge_m.bt = (int32_t)(system_time / 1000);
-	bat_object.state_of_charge_m.vi = (int32_t)(state_of_charge + 0.5f);
-	bat_object.voltage_m.vf = voltage;
-	bat_object.temperature_m.vf = temp;
+	bat_object.state_of_charge_m.vi = (int32_t)(bat_sample->state_of_charge + 0.5f);
+	bat_object.voltage_m.vf = bat_sample->voltage;
+	bat_object.temperature_m.vf = bat_sample->temperature;
 
 	err = cbor_encode_bat_object(payload.buffer, sizeof(payload.buffer),
 				     &bat_object, &payload.buffer_len);
@@ -285,54 +413,87 @@ static void sample(int64_t *ref_time)
 	}
 }
 
-static void task_wdt_callback(int channel_id, void *user_data)
+static void sample(int64_t *ref_time)
+{
+	int err;
+	struct bat_sample bat_sample;
+	int64_t system_time;
+
+	err = date_time_now(&system_time);
+	if (err) {
+		LOG_ERR("Failed to convert uptime to unix time, error: %d", err);
+		return;
+	}
+
+	if (latest_get(&bat_sample, ref_time)) {
+		return;
+	}
+
+	bat_sample_send(&bat_sample, system_time);
+}
+
+/* Samples taken before time is available are kept and sent with a timestamp derived from their
+ * uptime once it is.
+ */
+static void sample_pending(int64_t *ref_time)
 {
-	LOG_ERR("Watchdog expired, Channel: %d, Thread: %s",
-		channel_id, k_thread_name_get((k_tid_t)user_data));
+	struct bat_sample bat_sample;
+
+	if (latest_get(&bat_sample, ref_time)) {
+		return;
+	}
 
-	SEND_FATAL_ERROR_WATCHDOG_TIMEOUT();
+	pending_samples_push(&battery_pending, &bat_sample);
+}
+
+static void pending_sample_send(const void *sample, int64_t system_time)
+{
+	bat_sample_send(sample, system_time);
+}
+
+static void pending_flush(void)
+{
+	pending_samples_flush(&battery_pending, pending_sample_send);
 }
 
 static void battery_task(void)
 {
 	int err;
-	int task_wdt_id;
+	int supervisor_id;
 	const uint32_t wdt_timeout_ms = (CONFIG_APP_BATTERY_WATCHDOG_TIMEOUT_SECONDS * MSEC_PER_SEC);
-	const uint32_t execution_time_ms = (CONFIG_APP_BATTERY_EXEC_TIME_SECONDS_MAX * MSEC_PER_SEC);
-	const k_timeout_t zbus_wait_ms = K_MSEC(wdt_timeout_ms - execution_time_ms);
 
 	LOG_DBG("Battery module task started");
 
-	task_wdt_id = task_wdt_add(wdt_timeout_ms, task_wdt_callback, (void *)k_current_get());
+	supervisor_id = supervisor_add(&battery, wdt_timeout_ms);
+	if (supervisor_id < 0) {
+		LOG_ERR("supervisor_add, error: %d", supervisor_id);
+		SEND_FATAL_ERROR();
+		return;
+	}
 
-	STATE_SET_INITIAL(STATE_INIT);
+	STATE_SET_INITIAL(STATE_RUNNING);
 
 	while (true) {
-		err = task_wdt_feed(task_wdt_id);
+		err = zbus_sub_wait_msg(&battery, &s_obj.chan, s_obj.msg_buf, K_FOREVER);
 		if (err) {
-			LOG_ERR("task_wdt_feed, error: %d", err);
-			SEND_FATAL_ERROR();
-			return;
-		}
-
-		err = zbus_sub_wait_msg(&battery, &s_obj.chan, s_obj.msg_buf, zbus_wait_ms);
-		if (err == -ENOMSG) {
-			continue;
-		} else if (err) {
 			LOG_ERR("zbus_sub_wait_msg, error: %d", err);
 			SEND_FATAL_ERROR();
 			return;
 		}
 
+		supervisor_checkin(supervisor_id);
+
 		err = STATE_RUN();
 		if (err) {
 			LOG_ERR("handle_message, error: %d", err);
 			SEND_FATAL_ERROR();
 			return;
 		}
+
+		supervisor_checkout(supervisor_id);
 	}
 }
 
 K_THREAD_DEFINE(battery_task_id,
 		CONFIG_APP_BATTERY_THREAD_STACK_SIZE,
-		battery_task, NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+		battery_task, NULL, NULL, NULL, CONFIG_APP_THREAD_PRIORITY_BULK, 0, 0);
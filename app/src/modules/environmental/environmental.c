@@ -8,14 +8,17 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/zbus/zbus.h>
 #include <zephyr/drivers/sensor.h>
-#include <zephyr/task_wdt/task_wdt.h>
 #include <drivers/bme68x_iaq.h>
 #include <date_time.h>
 #include <zephyr/smf.h>
+#include <zephyr/pm/device.h>
 
 #include "message_channel.h"
 #include "modules_common.h"
+#include "supervisor.h"
+#include "pending_samples.h"
 #include "env_object_encode.h"
+#include "environmental.h"
 
 /* Register log module */
 LOG_MODULE_REGISTER(environmental_module, CONFIG_APP_ENVIRONMENTAL_LOG_LEVEL);
@@ -23,30 +26,188 @@ LOG_MODULE_REGISTER(environmental_module, CONFIG_APP_ENVIRONMENTAL_LOG_LEVEL);
 /* Register subscriber */
 ZBUS_MSG_SUBSCRIBER_DEFINE(environmental);
 
-/* Observe trigger channel */
-ZBUS_CHAN_ADD_OBS(TRIGGER_CHAN, environmental, 0);
-ZBUS_CHAN_ADD_OBS(TIME_CHAN, environmental, 0);
+/* Observe channels */
+#define CHANNELS TRIGGER_CHAN, TIME_CHAN, ENV_CONFIG_CHAN
 
-#define MAX_MSG_SIZE (MAX(sizeof(enum trigger_type), sizeof(enum time_status)))
+CHAN_ADD_OBS(environmental, CHANNELS);
 
-BUILD_ASSERT(CONFIG_APP_ENVIRONMENTAL_WATCHDOG_TIMEOUT_SECONDS >
-			CONFIG_APP_ENVIRONMENTAL_EXEC_TIME_SECONDS_MAX,
-			"Watchdog timeout must be greater than maximum execution time");
+#define MAX_MSG_SIZE CHAN_MSG_SIZE_MAX(CHANNELS)
 
 static const struct device *const sensor_dev = DEVICE_DT_GET(DT_ALIAS(gas_sensor));
 
+/* Latest sample, updated from the data ready trigger of the sensor if it is supported */
+static struct env_snapshot snapshot;
+static bool snapshot_valid;
+static bool snapshot_from_trigger;
+static struct k_spinlock snapshot_lock;
+
+#if defined(CONFIG_APP_ENVIRONMENTAL_SENSOR_PM)
+/* Whether the sensor is suspended between samples, checked once at startup */
+static bool sensor_pm_enabled;
+#endif /* CONFIG_APP_ENVIRONMENTAL_SENSOR_PM */
+
+static struct sensor_trigger data_ready_trigger = {
+	.type = SENSOR_TRIG_DATA_READY,
+	.chan = SENSOR_CHAN_ALL,
+};
+
+BUILD_ASSERT(CONFIG_APP_ENVIRONMENTAL_HEARTBEAT_INTERVALS <= ENV_HEARTBEAT_INTERVALS_MAX,
+	     "The heartbeat must be within the range accepted from the shadow");
+
+/* Deadband configuration, see struct env_configuration */
+static struct env_configuration env_config = {
+	.heartbeat = CONFIG_APP_ENVIRONMENTAL_HEARTBEAT_INTERVALS,
+	.resources = CONFIG_APP_ENVIRONMENTAL_RESOURCES,
+};
+
+/* Last sent sample, and the number of samples that have not been sent since */
+static struct env_sample sent_sample;
+static bool sent_sample_valid;
+static uint32_t samples_suppressed;
+
+#if defined(CONFIG_APP_ENVIRONMENTAL_AGGREGATION)
+/* Running aggregates of a quantity over a reporting period. The squares are summed as
+ * deviations from the first sample of the period. The variance is computed in integers from
+ * count * sum_squares, which for the raw pressure in pascals would exceed 64 bits after about
+ * 30000 samples, the deviations keep it small.
+ */
+struct aggregate {
+	int32_t min;
+	int32_t max;
+	int64_t sum;
+	int32_t first;
+	int64_t sum_squares;
+	int32_t last;
+};
+
+/* Aggregates of the local samples taken over a reporting period */
+struct accumulator {
+	struct aggregate temperature;
+	struct aggregate humidity;
+	struct aggregate pressure;
+	struct aggregate iaq;
+
+	/* Number of samples in the aggregates */
+	uint32_t count;
+
+	/* Cycles spent aggregating the samples, reading them from the sensor is not included */
+	uint64_t cycles;
+};
+
+static struct accumulator accumulator;
+
+/* Uptime of the last measurement that was aggregated. The driver may measure less often than
+ * samples are taken, a measurement is only aggregated once.
+ */
+static int64_t aggregated_ms = -1;
+
+/* Worst case encoded size of the aggregates */
+#define AGGREGATE_SIZE_MAX 262
+
+BUILD_ASSERT(AGGREGATE_SIZE_MAX <= CONFIG_APP_PAYLOAD_CHANNEL_BUFFER_MAX_SIZE,
+	     "The aggregates do not fit the payload");
+
+BUILD_ASSERT(CONFIG_APP_ENVIRONMENTAL_AGGREGATION_SAMPLE_INTERVAL_SECONDS >=
+	     CONFIG_APP_ENVIRONMENTAL_SENSOR_MEASUREMENT_INTERVAL_SECONDS,
+	     "Local samples are taken more often than the sensor measures");
+
+/* Enumerator to be used in private environmental channel */
+enum priv_environmental_evt {
+	/* Time to take a local sample */
+	ENVIRONMENTAL_PRIV_LOCAL_SAMPLE,
+};
+
+/* Private channel used to signal when a local sample is due */
+ZBUS_CHAN_DECLARE(PRIV_ENVIRONMENTAL_CHAN);
+ZBUS_CHAN_DEFINE(PRIV_ENVIRONMENTAL_CHAN,
+		 enum priv_environmental_evt,
+		 NULL,
+		 NULL,
+		 ZBUS_OBSERVERS(environmental),
+		 ZBUS_MSG_INIT(0)
+);
+
+#if defined(CONFIG_APP_MODULE_TRACE)
+ZBUS_CHAN_ADD_OBS(PRIV_ENVIRONMENTAL_CHAN, module_trace, 0);
+#endif
+
+/* Timer used to take local samples between data sample triggers */
+static void local_sample_timer_handler(struct k_timer *timer_id);
+static K_TIMER_DEFINE(local_sample_timer, local_sample_timer_handler, NULL);
+
+static void local_sample(void);
+
+#if defined(CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING)
+/* Number of local samples that the activity of a quantity is estimated over */
+#define ACTIVITY_WINDOW 4
+
+/* Rates of change are clamped so that the sum of their squares over the window fits */
+#define ACTIVITY_RATE_MAX	1000000
+
+/* Short-term activity of a quantity, the rates of change between the last local samples */
+struct activity {
+	int32_t rates[ACTIVITY_WINDOW];
+	int32_t reference;
+	int32_t threshold;
+};
+
+static struct adaptive {
+	struct activity temperature;
+	struct activity humidity;
+	struct activity pressure;
+	struct activity iaq;
+
+	/* Uptime of the reference sample that rates of change are calculated from */
+	int64_t reference_ms;
+	bool reference_valid;
+
+	/* Position of the next rate of change in the window */
+	size_t index;
+
+	/* Local sampling interval in use, and its bounds */
+	uint32_t interval_sec;
+	uint32_t interval_min_sec;
+	uint32_t interval_max_sec;
+} adaptive = {
+	.temperature.threshold = CONFIG_APP_ENVIRONMENTAL_ACTIVITY_TEMPERATURE,
+	.humidity.threshold = CONFIG_APP_ENVIRONMENTAL_ACTIVITY_HUMIDITY,
+	.pressure.threshold = CONFIG_APP_ENVIRONMENTAL_ACTIVITY_PRESSURE,
+	.iaq.threshold = CONFIG_APP_ENVIRONMENTAL_ACTIVITY_IAQ,
+	.interval_sec = CONFIG_APP_ENVIRONMENTAL_AGGREGATION_SAMPLE_INTERVAL_SECONDS,
+	.interval_min_sec = CONFIG_APP_ENVIRONMENTAL_AGGREGATION_SAMPLE_INTERVAL_MIN_SECONDS,
+	.interval_max_sec = CONFIG_APP_ENVIRONMENTAL_AGGREGATION_SAMPLE_INTERVAL_SECONDS,
+};
+
+BUILD_ASSERT(CONFIG_APP_ENVIRONMENTAL_AGGREGATION_SAMPLE_INTERVAL_MIN_SECONDS >=
+	     CONFIG_APP_ENVIRONMENTAL_SENSOR_MEASUREMENT_INTERVAL_SECONDS,
+	     "Local samples are taken more often than the sensor measures");
+
+static void local_sampling_bounds_update(const struct env_configuration *config);
+#endif /* CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING */
+#else
+/* Samples taken before time was available */
+PENDING_SAMPLES_DEFINE(environmental_pending, struct env_sample);
+#endif /* CONFIG_APP_ENVIRONMENTAL_AGGREGATION */
+
 /* Forward declarations */
 static struct s_object s_obj;
 static void sample(void);
+static void sample_pending(void);
+static void pending_flush(void);
+static void local_sampling_start(void);
 
 /* State machine */
 
 /* Defininig the module states.
  *
- * STATE_INIT: The environmental module is initializing and waiting for time to be available.
- * STATE_SAMPLING: The environmental module is ready to sample upon receiving a trigger.
+ * STATE_RUNNING: The environmental module is running, configuration is applied and local
+ *		  samples are taken in any state.
+ *	STATE_INIT: The environmental module is waiting for time to be available. Samples are
+ *		    kept with their uptime until then.
+ *	STATE_SAMPLING: The environmental module is ready to sample upon receiving a trigger.
  */
 enum environmental_module_state {
+	STATE_RUNNING,
 	STATE_INIT,
 	STATE_SAMPLING,
 };
@@ -66,23 +227,100 @@ struct s_object {
 };
 
 /* Forward declarations of state handlers */
+static void state_running_entry(void *o);
+static enum smf_state_result state_running_run(void *o);
 static enum smf_state_result state_init_run(void *o);
+static void state_sampling_entry(void *o);
 static enum smf_state_result state_sampling_run(void *o);
 
 static struct s_object s_obj;
 static const struct smf_state states[] = {
+	[STATE_RUNNING] =
+		SMF_CREATE_STATE(state_running_entry, state_running_run, NULL,
+				 NULL,	/* No parent state */
+				 &states[STATE_INIT]),
 	[STATE_INIT] =
 		SMF_CREATE_STATE(NULL, state_init_run, NULL,
-				 NULL,	/* No parent state */
+				 &states[STATE_RUNNING],
 				 NULL), /* No initial transition */
 	[STATE_SAMPLING] =
-		SMF_CREATE_STATE(NULL, state_sampling_run, NULL,
-				 NULL,
+		SMF_CREATE_STATE(state_sampling_entry, state_sampling_run, NULL,
+				 &states[STATE_RUNNING],
 				 NULL),
 };
 
 /* State handlers */
 
+static void deadband_update(struct env_deadband *dst, const struct env_deadband *src)
+{
+	if (src->absolute_present) {
+		dst->absolute = src->absolute;
+	}
+
+	if (src->relative_present) {
+		dst->relative = src->relative;
+	}
+}
+
+static void state_running_entry(void *o)
+{
+	ARG_UNUSED(o);
+
+	local_sampling_start();
+}
+
+static enum smf_state_result state_running_run(void *o)
+{
+	struct s_object *state_object = o;
+
+	if (&ENV_CONFIG_CHAN == state_object->chan) {
+		const struct env_configuration *config =
+			MSG_TO_ENV_CONFIGURATION(state_object->msg_buf);
+
+		deadband_update(&env_config.temperature, &config->temperature);
+		deadband_update(&env_config.humidity, &config->humidity);
+		deadband_update(&env_config.pressure, &config->pressure);
+		deadband_update(&env_config.iaq, &config->iaq);
+
+		if (config->heartbeat_present) {
+			env_config.heartbeat = config->heartbeat;
+		}
+
+		if (config->resources_present) {
+			/* The aggregate and series objects have a fixed set of resources */
+			if (IS_ENABLED(CONFIG_APP_ENVIRONMENTAL_REPORT_SINGLE)) {
+				env_config.resources = config->resources;
+			} else {
+				LOG_WRN("Resources mask 0x%x ignored in this report mode",
+					config->resources);
+			}
+		}
+
+#if defined(CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING)
+		local_sampling_bounds_update(config);
+#else
+		if (config->sample_interval_min_present || config->sample_interval_max_present) {
+			LOG_WRN("Local sampling interval bounds ignored without adaptive sampling");
+		}
+#endif /* CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING */
+
+		LOG_DBG("Configuration updated, heartbeat: %d intervals, resources: 0x%x",
+			env_config.heartbeat, env_config.resources);
+
+		return SMF_EVENT_HANDLED;
+	}
+
+#if defined(CONFIG_APP_ENVIRONMENTAL_AGGREGATION)
+	if (&PRIV_ENVIRONMENTAL_CHAN == state_object->chan) {
+		local_sample();
+
+		return SMF_EVENT_HANDLED;
+	}
+#endif /* CONFIG_APP_ENVIRONMENTAL_AGGREGATION */
+
+	return SMF_EVENT_PROPAGATE;
+}
+
 static enum smf_state_result state_init_run(void *o)
 {
 	struct s_object *state_object = o;
@@ -98,9 +336,25 @@ static enum smf_state_result state_init_run(void *o)
 		}
 	}
 
+	if (&TRIGGER_CHAN == state_object->chan) {
+		enum trigger_type trigger_type = MSG_TO_TRIGGER_TYPE(state_object->msg_buf);
+
+		if (trigger_type == TRIGGER_DATA_SAMPLE) {
+			LOG_DBG("Data sample trigger received before time is available");
+			sample_pending();
+		}
+	}
+
 	return SMF_EVENT_PROPAGATE;
 }
 
+static void state_sampling_entry(void *o)
+{
+	ARG_UNUSED(o);
+
+	pending_flush();
+}
+
 static enum smf_state_result state_sampling_run(void *o)
 {
 	struct s_object *state_object = o;
@@ -119,58 +373,893 @@ static enum smf_state_result state_sampling_run(void *o)
 
 /* End of state handling */
 
-static void task_wdt_callback(int channel_id, void *user_data)
+/* Convert a sensor value to fixed point with the given number of parts per unit, rounded to
+ * the nearest part, without going through floating point.
+ */
+static int32_t value_to_fixed(const struct sensor_value *value, int32_t scale)
 {
-	LOG_ERR("Watchdog expired, Channel: %d, Thread: %s",
-		channel_id, k_thread_name_get((k_tid_t)user_data));
+	int64_t micro = (int64_t)value->val2 * scale;
+	int64_t half = (micro < 0) ? -500000 : 500000;
 
-	SEND_FATAL_ERROR_WATCHDOG_TIMEOUT();
+	return value->val1 * scale + (int32_t)((micro + half) / 1000000);
 }
 
-static void sample(void)
+/* Convert hundredths of a unit to the value that is encoded */
+static float centi_to_float(int32_t value)
+{
+	return (float)value / 100.0f;
+}
+
+static int sensor_read(struct env_sample *env_sample)
 {
-	int64_t system_time;
-	struct payload payload = { 0 };
 	struct sensor_value temp = { 0 };
 	struct sensor_value press = { 0 };
 	struct sensor_value humidity = { 0 };
 	struct sensor_value iaq = { 0 };
 	struct sensor_value co2 = { 0 };
 	struct sensor_value voc = { 0 };
-	struct env_object env_obj = { 0 };
 	int ret;
 
 	ret = sensor_sample_fetch(sensor_dev);
-	__ASSERT_NO_MSG(ret == 0);
-	ret = sensor_channel_get(sensor_dev, SENSOR_CHAN_AMBIENT_TEMP, &temp);
-	__ASSERT_NO_MSG(ret == 0);
-	ret = sensor_channel_get(sensor_dev, SENSOR_CHAN_PRESS, &press);
-	__ASSERT_NO_MSG(ret == 0);
-	ret = sensor_channel_get(sensor_dev, SENSOR_CHAN_HUMIDITY, &humidity);
-	__ASSERT_NO_MSG(ret == 0);
-	ret = sensor_channel_get(sensor_dev, SENSOR_CHAN_IAQ, &iaq);
-	__ASSERT_NO_MSG(ret == 0);
-	ret = sensor_channel_get(sensor_dev, SENSOR_CHAN_CO2, &co2);
-	__ASSERT_NO_MSG(ret == 0);
-	ret = sensor_channel_get(sensor_dev, SENSOR_CHAN_VOC, &voc);
-	__ASSERT_NO_MSG(ret == 0);
+	if (ret) {
+		LOG_ERR("sensor_sample_fetch, error: %d", ret);
+		return ret;
+	}
+
+	ret = sensor_channel_get(sensor_dev, SENSOR_CHAN_AMBIENT_TEMP, &temp) ||
+	      sensor_channel_get(sensor_dev, SENSOR_CHAN_PRESS, &press) ||
+	      sensor_channel_get(sensor_dev, SENSOR_CHAN_HUMIDITY, &humidity) ||
+	      sensor_channel_get(sensor_dev, SENSOR_CHAN_IAQ, &iaq) ||
+	      sensor_channel_get(sensor_dev, SENSOR_CHAN_CO2, &co2) ||
+	      sensor_channel_get(sensor_dev, SENSOR_CHAN_VOC, &voc);
+	if (ret) {
+		LOG_ERR("sensor_channel_get failed");
+		return -EIO;
+	}
 
 	LOG_DBG("temp: %d.%06d; press: %d.%06d; humidity: %d.%06d; iaq: %d; CO2: %d.%06d; "
 		"VOC: %d.%06d",
 		temp.val1, temp.val2, press.val1, press.val2, humidity.val1, humidity.val2,
 		iaq.val1, co2.val1, co2.val2, voc.val1, voc.val2);
 
+	env_sample->temperature = value_to_fixed(&temp, 100);
+	env_sample->humidity = value_to_fixed(&humidity, 100);
+	/* The sensor reports pascals, which are hundredths of the hectopascals that are sent */
+	env_sample->pressure = value_to_fixed(&press, 1);
+	env_sample->iaq = iaq.val1;
+	env_sample->co2 = value_to_fixed(&co2, 1);
+	/* The sensor reports ppm */
+	env_sample->voc = value_to_fixed(&voc, 1000);
+
+	return 0;
+}
+
+static void snapshot_update(const struct env_sample *env_sample, uint32_t latency_ms)
+{
+	k_spinlock_key_t key = k_spin_lock(&snapshot_lock);
+
+	snapshot.sample = *env_sample;
+	snapshot.uptime_ms = k_uptime_get();
+	snapshot.latency_ms = latency_ms;
+	snapshot_valid = true;
+
+	k_spin_unlock(&snapshot_lock, key);
+}
+
+int env_snapshot_get(struct env_snapshot *dst)
+{
+	int err = 0;
+	k_spinlock_key_t key = k_spin_lock(&snapshot_lock);
+
+	if (snapshot_valid) {
+		*dst = snapshot;
+	} else {
+		err = -ENODATA;
+	}
+
+	k_spin_unlock(&snapshot_lock, key);
+
+	return err;
+}
+
+/* Called by the sensor driver when it has new results, the IAQ driver measures periodically
+ * on its own.
+ */
+static void data_ready_handler(const struct device *dev, const struct sensor_trigger *trigger)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(trigger);
+
+	struct env_sample env_sample;
+
+	if (sensor_read(&env_sample)) {
+		return;
+	}
+
+	snapshot_update(&env_sample, 0);
+}
+
+#if defined(CONFIG_APP_ENVIRONMENTAL_SENSOR_PM)
+static int sensor_pm_action(enum pm_device_action action)
+{
+	int err = pm_device_action_run(sensor_dev, action);
+
+	if (err && (err != -EALREADY)) {
+		LOG_ERR("pm_device_action_run(%d), error: %d", action, err);
+		return err;
+	}
+
+	return 0;
+}
+
+/* Resume the sensor, wait for it to warm up, read it and suspend it again. The time spent
+ * before the read is the latency added to the sample.
+ */
+static int sensor_read_resumed(struct env_sample *env_sample, uint32_t *latency_ms)
+{
+	int64_t start = k_uptime_get();
+	int err;
+
+	err = sensor_pm_action(PM_DEVICE_ACTION_RESUME);
+	if (err) {
+		return err;
+	}
+
+	k_sleep(K_MSEC(CONFIG_APP_ENVIRONMENTAL_SENSOR_WARMUP_MS));
+
+	*latency_ms = (uint32_t)(k_uptime_get() - start);
+
+	err = sensor_read(env_sample);
+
+	(void)sensor_pm_action(PM_DEVICE_ACTION_SUSPEND);
+
+	LOG_DBG("Sensor resumed for sampling, %u ms of added latency", *latency_ms);
+
+	return err;
+}
+#endif /* CONFIG_APP_ENVIRONMENTAL_SENSOR_PM */
+
+static void snapshot_init(void)
+{
+	int err;
+
+#if defined(CONFIG_APP_ENVIRONMENTAL_SENSOR_PM)
+	/* The sensor does not measure on its own while it is suspended, it is only resumed
+	 * to be sampled. A sensor driver without device power management keeps the sensor
+	 * running, with the snapshot updated by the data ready trigger.
+	 */
+	err = pm_device_action_run(sensor_dev, PM_DEVICE_ACTION_SUSPEND);
+	if (!err || (err == -EALREADY)) {
+		sensor_pm_enabled = true;
+
+		LOG_DBG("Sensor suspended between samples, sampling on demand");
+		return;
+	}
+
+	LOG_WRN("Sensor cannot be suspended, error: %d, keeping it running", err);
+#endif /* CONFIG_APP_ENVIRONMENTAL_SENSOR_PM */
+
+	err = sensor_trigger_set(sensor_dev, &data_ready_trigger, data_ready_handler);
+	if (err) {
+		LOG_WRN("Data ready trigger not supported, error: %d, sampling on demand", err);
+		return;
+	}
+
+	snapshot_from_trigger = true;
+}
+
+/* Get a sample, from the snapshot if the sensor driver keeps it up to date. The sensor is
+ * read if the snapshot is missing or older than expected from the driver. The uptime of the
+ * measurement is returned in uptime_ms if it is not NULL, the same measurement is returned
+ * until the driver signals new results.
+ */
+static int sample_get(struct env_sample *env_sample, int64_t *uptime_ms)
+{
+	int err;
+	struct env_snapshot latest;
+
+	if (snapshot_from_trigger && !env_snapshot_get(&latest)) {
+		int64_t age_ms = k_uptime_get() - latest.uptime_ms;
+
+		if (age_ms <= (CONFIG_APP_ENVIRONMENTAL_SNAPSHOT_AGE_MAX_SECONDS * MSEC_PER_SEC)) {
+			LOG_DBG("Using snapshot, %lld ms old", age_ms);
+
+			*env_sample = latest.sample;
+
+			if (uptime_ms) {
+				*uptime_ms = latest.uptime_ms;
+			}
+
+			return 0;
+		}
+
+		LOG_DBG("Snapshot is %lld ms old, reading the sensor", age_ms);
+	}
+
+#if defined(CONFIG_APP_ENVIRONMENTAL_SENSOR_PM)
+	if (sensor_pm_enabled) {
+		uint32_t latency_ms;
+
+		err = sensor_read_resumed(env_sample, &latency_ms);
+		if (err) {
+			return err;
+		}
+
+		snapshot_update(env_sample, latency_ms);
+
+		if (uptime_ms) {
+			*uptime_ms = k_uptime_get();
+		}
+
+		return 0;
+	}
+#endif /* CONFIG_APP_ENVIRONMENTAL_SENSOR_PM */
+
+	err = sensor_read(env_sample);
+	if (err) {
+		return err;
+	}
+
+	snapshot_update(env_sample, 0);
+
+	if (uptime_ms) {
+		*uptime_ms = k_uptime_get();
+	}
+
+	return 0;
+}
+
+static int timestamp_get(int32_t *timestamp)
+{
+	int64_t system_time;
+	int ret;
+
 	ret = date_time_now(&system_time);
 	if (ret) {
 		LOG_ERR("Failed to convert uptime to unix time, error: %d", ret);
+		return ret;
+	}
+
+	*timestamp = (int32_t)(system_time / 1000);
+
+	return 0;
+}
+
+static void payload_send(const struct payload *payload)
+{
+	LOG_DBG("Submitting payload");
+
+	int err = zbus_chan_pub(&PAYLOAD_CHAN, payload, K_SECONDS(1));
+	if (err) {
+		LOG_ERR("zbus_chan_pub, error: %d", err);
+		SEND_FATAL_ERROR();
 		return;
 	}
+}
+
+static bool deadband_set(const struct env_deadband *deadband)
+{
+	return deadband->absolute || deadband->relative;
+}
+
+/* Values are in hundredths of their unit, like the absolute deadband. The relative deadband is
+ * in tenths of a percent of the sent value.
+ */
+static bool value_changed(const struct env_deadband *deadband, int64_t sent, int64_t value)
+{
+	int64_t delta = (value > sent) ? (value - sent) : (sent - value);
+	int64_t sent_magnitude = (sent < 0) ? -sent : sent;
+
+	return (delta > deadband->absolute) &&
+	       (delta * 1000 > sent_magnitude * deadband->relative);
+}
+
+static bool resource_enabled(uint32_t resource)
+{
+	return (env_config.resources & resource) != 0;
+}
+
+/* Only the values that are sent are compared. CO2 and VOC have no deadbands, like the other
+ * values without a deadband set, any change of them counts.
+ */
+static bool sample_changed(const struct env_sample *env_sample)
+{
+	static const struct env_deadband no_deadband;
+
+	return (resource_enabled(ENV_RESOURCE_TEMPERATURE) &&
+		value_changed(&env_config.temperature, sent_sample.temperature,
+			      env_sample->temperature)) ||
+	       (resource_enabled(ENV_RESOURCE_HUMIDITY) &&
+		value_changed(&env_config.humidity, sent_sample.humidity, env_sample->humidity)) ||
+	       (resource_enabled(ENV_RESOURCE_PRESSURE) &&
+		value_changed(&env_config.pressure, sent_sample.pressure, env_sample->pressure)) ||
+	       (resource_enabled(ENV_RESOURCE_IAQ) &&
+		value_changed(&env_config.iaq, sent_sample.iaq * 100LL, env_sample->iaq * 100LL)) ||
+	       (resource_enabled(ENV_RESOURCE_CO2) &&
+		value_changed(&no_deadband, sent_sample.co2, env_sample->co2)) ||
+	       (resource_enabled(ENV_RESOURCE_VOC) &&
+		value_changed(&no_deadband, sent_sample.voc, env_sample->voc));
+}
+
+/* Returns true if the samples of an interval are to be sent. Until a deadband is set, every
+ * sample is sent.
+ */
+static bool send_due(const struct env_sample *samples, size_t count)
+{
+	if (!sent_sample_valid ||
+	    (!deadband_set(&env_config.temperature) && !deadband_set(&env_config.humidity) &&
+	     !deadband_set(&env_config.pressure) && !deadband_set(&env_config.iaq))) {
+		return true;
+	}
+
+	if ((samples_suppressed + 1) >= env_config.heartbeat) {
+		LOG_DBG("Heartbeat interval reached");
+		return true;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		if (sample_changed(&samples[i])) {
+			return true;
+		}
+	}
+
+	LOG_DBG("No value changed by more than its deadband, sample not sent");
+
+	samples_suppressed++;
+
+	return false;
+}
+
+static void sample_sent(const struct env_sample *env_sample)
+{
+	sent_sample = *env_sample;
+	sent_sample_valid = true;
+	samples_suppressed = 0;
+}
+
+#if defined(CONFIG_APP_ENVIRONMENTAL_AGGREGATION)
+static void local_sample_timer_handler(struct k_timer *timer_id)
+{
+	ARG_UNUSED(timer_id);
+
+	enum priv_environmental_evt evt = ENVIRONMENTAL_PRIV_LOCAL_SAMPLE;
+	int err;
+
+	/* A local sample that cannot be queued is skipped, the next one is taken on time */
+	err = zbus_chan_pub(&PRIV_ENVIRONMENTAL_CHAN, &evt, K_NO_WAIT);
+	if (err) {
+		LOG_WRN("Local sample skipped, zbus_chan_pub, error: %d", err);
+	}
+}
+
+uint32_t env_local_sample_interval_get(void)
+{
+#if defined(CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING)
+	return adaptive.interval_sec;
+#else
+	return CONFIG_APP_ENVIRONMENTAL_AGGREGATION_SAMPLE_INTERVAL_SECONDS;
+#endif /* CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING */
+}
+
+/* Restart the local sampling period, so that local samples are evenly spaced over the
+ * reporting period that follows.
+ */
+static void local_sampling_start(void)
+{
+	k_timeout_t interval = K_SECONDS(env_local_sample_interval_get());
 
-	env_obj.temperature_m.bt = (int32_t)(system_time / 1000);
-	env_obj.temperature_m.vf = sensor_value_to_double(&temp);
-	env_obj.humidity_m.vf = sensor_value_to_double(&humidity);
-	env_obj.pressure_m.vf = sensor_value_to_double(&press) / 100;
-	env_obj.iaq_m.vi = iaq.val1;
+#if defined(CONFIG_APP_ENVIRONMENTAL_SENSOR_PM)
+	/* Local samples are taken after the sensor has warmed up, the timer expires that much
+	 * earlier so that they stay on the interval.
+	 */
+	if (sensor_pm_enabled) {
+		int64_t first_ms = MAX((int64_t)env_local_sample_interval_get() * MSEC_PER_SEC -
+				       CONFIG_APP_ENVIRONMENTAL_SENSOR_WARMUP_MS, 0);
+
+		k_timer_start(&local_sample_timer, K_MSEC(first_ms), interval);
+		return;
+	}
+#endif /* CONFIG_APP_ENVIRONMENTAL_SENSOR_PM */
+
+	k_timer_start(&local_sample_timer, interval, interval);
+}
+
+#if defined(CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING)
+/* Add the rate of change since the reference sample to the window of a quantity, and return
+ * whether the quantity is moving. The mean square of the rates over the window estimates the
+ * short-term variance of the quantity around a flat signal.
+ */
+static bool activity_update(struct activity *activity, int32_t value, int64_t elapsed_ms)
+{
+	int64_t rate = ((int64_t)value - activity->reference) * 60 * MSEC_PER_SEC / elapsed_ms;
+	int64_t square_sum = 0;
+
+	activity->rates[adaptive.index] = (int32_t)CLAMP(rate, -ACTIVITY_RATE_MAX,
+							 ACTIVITY_RATE_MAX);
+	activity->reference = value;
+
+	for (size_t i = 0; i < ACTIVITY_WINDOW; i++) {
+		square_sum += (int64_t)activity->rates[i] * activity->rates[i];
+	}
+
+	return square_sum > (int64_t)ACTIVITY_WINDOW * activity->threshold * activity->threshold;
+}
+
+static void activity_reference_set(const struct env_sample *env_sample, int64_t uptime_ms)
+{
+	adaptive.temperature.reference = env_sample->temperature;
+	adaptive.humidity.reference = env_sample->humidity;
+	adaptive.pressure.reference = env_sample->pressure;
+	adaptive.iaq.reference = env_sample->iaq;
+	adaptive.reference_ms = uptime_ms;
+	adaptive.reference_valid = true;
+}
+
+/* Halve the local sampling interval while any quantity is moving, and double it while all
+ * are flat, within the configured bounds.
+ */
+static void local_sampling_adapt(const struct env_sample *env_sample, int64_t uptime_ms)
+{
+	int64_t elapsed_ms = uptime_ms - adaptive.reference_ms;
+	uint32_t interval_sec;
+	bool moving = false;
+
+	if (!adaptive.reference_valid) {
+		activity_reference_set(env_sample, uptime_ms);
+		return;
+	}
+
+	/* Samples taken by a data sample trigger shortly after a local sample are too close for
+	 * the rate of change to be meaningful, the reference is kept for the next sample.
+	 */
+	if (elapsed_ms < ((int64_t)adaptive.interval_min_sec * MSEC_PER_SEC / 2)) {
+		return;
+	}
+
+	moving |= activity_update(&adaptive.temperature, env_sample->temperature, elapsed_ms);
+	moving |= activity_update(&adaptive.humidity, env_sample->humidity, elapsed_ms);
+	moving |= activity_update(&adaptive.pressure, env_sample->pressure, elapsed_ms);
+	moving |= activity_update(&adaptive.iaq, env_sample->iaq, elapsed_ms);
+
+	adaptive.index = (adaptive.index + 1) % ACTIVITY_WINDOW;
+	adaptive.reference_ms = uptime_ms;
+
+	if (moving) {
+		interval_sec = MAX(adaptive.interval_sec / 2, adaptive.interval_min_sec);
+	} else {
+		interval_sec = MIN(adaptive.interval_sec * 2, adaptive.interval_max_sec);
+	}
+
+	if (interval_sec == adaptive.interval_sec) {
+		return;
+	}
+
+	LOG_DBG("Values %s, local sampling interval %u seconds", moving ? "moving" : "flat",
+		interval_sec);
+
+	adaptive.interval_sec = interval_sec;
+	local_sampling_start();
+}
+
+/* Apply the bounds of the local sampling interval received in the environmental configuration,
+ * the interval in use is moved within them right away.
+ */
+static void local_sampling_bounds_update(const struct env_configuration *config)
+{
+	uint32_t min_sec = config->sample_interval_min_present ? config->sample_interval_min :
+								   adaptive.interval_min_sec;
+	uint32_t max_sec = config->sample_interval_max_present ? config->sample_interval_max :
+								   adaptive.interval_max_sec;
+	uint32_t interval_sec;
+
+	if (!config->sample_interval_min_present && !config->sample_interval_max_present) {
+		return;
+	}
+
+	if (min_sec > max_sec) {
+		LOG_WRN("Shortest local sampling interval %u above the longest %u, ignoring",
+			min_sec, max_sec);
+		return;
+	}
+
+	if (min_sec < CONFIG_APP_ENVIRONMENTAL_SENSOR_MEASUREMENT_INTERVAL_SECONDS) {
+		LOG_WRN("Shortest local sampling interval %u below the sensor measurement "
+			"interval %u, ignoring", min_sec,
+			CONFIG_APP_ENVIRONMENTAL_SENSOR_MEASUREMENT_INTERVAL_SECONDS);
+		return;
+	}
+
+	adaptive.interval_min_sec = min_sec;
+	adaptive.interval_max_sec = max_sec;
+
+	LOG_DBG("Local sampling interval bounds: %u to %u seconds", min_sec, max_sec);
+
+	interval_sec = CLAMP(adaptive.interval_sec, min_sec, max_sec);
+	if (interval_sec == adaptive.interval_sec) {
+		return;
+	}
+
+	adaptive.interval_sec = interval_sec;
+	local_sampling_start();
+}
+#endif /* CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING */
+
+static void aggregate_update(struct aggregate *aggregate, int32_t value, uint32_t count)
+{
+	int64_t deviation;
+
+	if (count == 0) {
+		aggregate->min = value;
+		aggregate->max = value;
+		aggregate->sum = 0;
+		aggregate->first = value;
+		aggregate->sum_squares = 0;
+	}
+
+	deviation = (int64_t)value - aggregate->first;
+
+	aggregate->min = MIN(aggregate->min, value);
+	aggregate->max = MAX(aggregate->max, value);
+	aggregate->sum += value;
+	aggregate->sum_squares += deviation * deviation;
+	aggregate->last = value;
+}
+
+/* Mean of an aggregate, rounded to the nearest integer */
+static int32_t aggregate_mean(const struct aggregate *aggregate, uint32_t count)
+{
+	int64_t half = (aggregate->sum < 0) ? -(int64_t)(count / 2) : (int64_t)(count / 2);
+
+	return (int32_t)((aggregate->sum + half) / (int64_t)count);
+}
+
+/* Integer square root, rounded down */
+static uint64_t isqrt64(uint64_t value)
+{
+	uint64_t root = 0;
+	uint64_t bit = 1ULL << 62;
+
+	while (bit > value) {
+		bit >>= 2;
+	}
+
+	while (bit) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+
+		bit >>= 2;
+	}
+
+	return root;
+}
+
+/* Population standard deviation of an aggregate, rounded to the nearest integer. The variance
+ * times count squared is count * sum_squares - deviation_sum^2, the rounded root of the
+ * variance is floor((floor(sqrt(4 * variance)) + 1) / 2).
+ */
+static int32_t aggregate_stddev(const struct aggregate *aggregate, uint32_t count)
+{
+	int64_t deviation_sum = aggregate->sum - (int64_t)aggregate->first * count;
+	int64_t scaled = (int64_t)count * aggregate->sum_squares - deviation_sum * deviation_sum;
+	uint64_t variance_x4 = 4 * (uint64_t)MAX(scaled, 0) / ((uint64_t)count * count);
+
+	return (int32_t)((isqrt64(variance_x4) + 1) / 2);
+}
+
+static void local_sample(void)
+{
+	struct env_sample env_sample;
+	int64_t uptime_ms;
+	uint32_t start;
+
+	if (sample_get(&env_sample, &uptime_ms)) {
+		return;
+	}
+
+	if (uptime_ms == aggregated_ms) {
+		LOG_DBG("No new measurement since the last sample, not aggregated");
+		return;
+	}
+
+	aggregated_ms = uptime_ms;
+	start = k_cycle_get_32();
+
+	aggregate_update(&accumulator.temperature, env_sample.temperature, accumulator.count);
+	aggregate_update(&accumulator.humidity, env_sample.humidity, accumulator.count);
+	aggregate_update(&accumulator.pressure, env_sample.pressure, accumulator.count);
+	aggregate_update(&accumulator.iaq, env_sample.iaq, accumulator.count);
+
+	accumulator.count++;
+	accumulator.cycles += k_cycle_get_32() - start;
+
+#if defined(CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING)
+	local_sampling_adapt(&env_sample, uptime_ms);
+#endif /* CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING */
+}
+
+/* Report the aggregates of the reporting period, the data sample trigger itself provides the
+ * last sample of the period.
+ */
+static void sample(void)
+{
+	struct payload payload = { 0 };
+	struct env_aggregate_object env_obj = { 0 };
+	const struct accumulator *acc = &accumulator;
+	int ret;
+
+	local_sample();
+
+	if (acc->count == 0) {
+		LOG_WRN("No new measurement in the reporting period");
+		return;
+	}
+
+	/* The extremes of the period are compared as well, so that transients are reported */
+	const struct env_sample period[] = {
+		{
+			.temperature = acc->temperature.last,
+			.humidity = acc->humidity.last,
+			.pressure = acc->pressure.last,
+			.iaq = acc->iaq.last,
+		},
+		{
+			.temperature = acc->temperature.min,
+			.humidity = acc->humidity.min,
+			.pressure = acc->pressure.min,
+			.iaq = acc->iaq.min,
+		},
+		{
+			.temperature = acc->temperature.max,
+			.humidity = acc->humidity.max,
+			.pressure = acc->pressure.max,
+			.iaq = acc->iaq.max,
+		},
+	};
+
+	if (!send_due(period, ARRAY_SIZE(period))) {
+		memset(&accumulator, 0, sizeof(accumulator));
+		local_sampling_start();
+		return;
+	}
+
+	ret = timestamp_get(&env_obj.temperature_m.bt.bt);
+	if (ret) {
+		return;
+	}
+
+	env_obj.temperature_m.bn_present = true;
+	env_obj.temperature_m.bt_present = true;
+
+	LOG_DBG("%u samples aggregated, %u cycles of aggregation per sample", acc->count,
+		(uint32_t)(acc->cycles / acc->count));
+
+	env_obj.temperature_m.vf = centi_to_float(acc->temperature.last);
+	env_obj.humidity_m.vf = centi_to_float(acc->humidity.last);
+	env_obj.pressure_m.vf = centi_to_float(acc->pressure.last);
+	env_obj.iaq_m.vi = acc->iaq.last;
+
+	env_obj.min_temperature_m.vf = centi_to_float(acc->temperature.min);
+	env_obj.min_humidity_m.vf = centi_to_float(acc->humidity.min);
+	env_obj.min_pressure_m.vf = centi_to_float(acc->pressure.min);
+	env_obj.min_iaq_m.vi = acc->iaq.min;
+
+	env_obj.max_temperature_m.vf = centi_to_float(acc->temperature.max);
+	env_obj.max_humidity_m.vf = centi_to_float(acc->humidity.max);
+	env_obj.max_pressure_m.vf = centi_to_float(acc->pressure.max);
+	env_obj.max_iaq_m.vi = acc->iaq.max;
+
+	env_obj.mean_temperature_m.vf =
+		centi_to_float(aggregate_mean(&acc->temperature, acc->count));
+	env_obj.mean_humidity_m.vf = centi_to_float(aggregate_mean(&acc->humidity, acc->count));
+	env_obj.mean_pressure_m.vf = centi_to_float(aggregate_mean(&acc->pressure, acc->count));
+	env_obj.mean_iaq_m.vi = aggregate_mean(&acc->iaq, acc->count);
+
+	env_obj.stddev_temperature_m.vf =
+		centi_to_float(aggregate_stddev(&acc->temperature, acc->count));
+	env_obj.stddev_humidity_m.vf =
+		centi_to_float(aggregate_stddev(&acc->humidity, acc->count));
+	env_obj.stddev_pressure_m.vf =
+		centi_to_float(aggregate_stddev(&acc->pressure, acc->count));
+	env_obj.stddev_iaq_m.vi = aggregate_stddev(&acc->iaq, acc->count);
+
+	memset(&accumulator, 0, sizeof(accumulator));
+	local_sampling_start();
+
+	ret = cbor_encode_env_aggregate_object(payload.buffer, sizeof(payload.buffer),
+					       &env_obj, &payload.buffer_len);
+	if (ret) {
+		LOG_ERR("Failed to encode env aggregate object, error: %d", ret);
+		SEND_FATAL_ERROR();
+		return;
+	}
+
+	payload_send(&payload);
+	sample_sent(&period[0]);
+}
+#elif defined(CONFIG_APP_ENVIRONMENTAL_SERIES)
+
+/* Worst case encoded size of the first sample of a series, and of each sample that follows */
+#define SERIES_FIRST_SAMPLE_SIZE_MAX	81
+#define SERIES_SAMPLE_SIZE_MAX		52
+
+BUILD_ASSERT(SERIES_FIRST_SAMPLE_SIZE_MAX +
+	     (CONFIG_APP_ENVIRONMENTAL_SERIES_SAMPLES - 1) * SERIES_SAMPLE_SIZE_MAX <=
+	     CONFIG_APP_PAYLOAD_CHANNEL_BUFFER_MAX_SIZE,
+	     "Series of CONFIG_APP_ENVIRONMENTAL_SERIES_SAMPLES samples do not fit the payload");
+BUILD_ASSERT(CONFIG_APP_ENVIRONMENTAL_SERIES_SAMPLES - 1 <=
+	     ARRAY_SIZE(((struct env_series_object *)0)->series_temperature_value_m),
+	     "Series of CONFIG_APP_ENVIRONMENTAL_SERIES_SAMPLES samples do not fit env_object.cddl");
+
+/* Samples buffered for the next series, and their UNIX timestamps in seconds */
+static struct env_sample series[CONFIG_APP_ENVIRONMENTAL_SERIES_SAMPLES];
+static int32_t series_timestamps[CONFIG_APP_ENVIRONMENTAL_SERIES_SAMPLES];
+static size_t series_count;
+
+static void local_sampling_start(void)
+{
+}
+
+static void series_send(void)
+{
+	/* Kept off the module thread stack */
+	static struct env_series_object env_obj;
+	struct payload payload = { 0 };
+	size_t values = series_count - 1;
+	int ret;
+
+	memset(&env_obj, 0, sizeof(env_obj));
+
+	env_obj.series_temperature_m.bt = series_timestamps[0];
+	env_obj.series_temperature_m.vf = centi_to_float(series[0].temperature);
+	env_obj.series_humidity_m.vf = centi_to_float(series[0].humidity);
+	env_obj.series_pressure_m.vf = centi_to_float(series[0].pressure);
+	env_obj.series_iaq_m.vi = series[0].iaq;
+
+	for (size_t i = 0; i < values; i++) {
+		const struct env_sample *env_sample = &series[i + 1];
+		int32_t offset = series_timestamps[i + 1] - series_timestamps[0];
+
+		env_obj.series_temperature_value_m[i].vf = centi_to_float(env_sample->temperature);
+		env_obj.series_temperature_value_m[i].t = offset;
+		env_obj.series_humidity_value_m[i].vf = centi_to_float(env_sample->humidity);
+		env_obj.series_humidity_value_m[i].t = offset;
+		env_obj.series_pressure_value_m[i].vf = centi_to_float(env_sample->pressure);
+		env_obj.series_pressure_value_m[i].t = offset;
+		env_obj.series_iaq_value_m[i].vi = env_sample->iaq;
+		env_obj.series_iaq_value_m[i].t = offset;
+	}
+
+	env_obj.series_temperature_value_m_count = values;
+	env_obj.series_humidity_value_m_count = values;
+	env_obj.series_pressure_value_m_count = values;
+	env_obj.series_iaq_value_m_count = values;
+
+	ret = cbor_encode_env_series_object(payload.buffer, sizeof(payload.buffer),
+					    &env_obj, &payload.buffer_len);
+	if (ret) {
+		LOG_ERR("Failed to encode env series object, error: %d", ret);
+		SEND_FATAL_ERROR();
+		return;
+	}
+
+	LOG_DBG("Series of %zu samples encoded, %zu bytes per sample", series_count,
+		payload.buffer_len / series_count);
+
+	series_count = 0;
+
+	payload_send(&payload);
+}
+
+static void sample_add(const struct env_sample *env_sample, int32_t timestamp)
+{
+	if (!send_due(env_sample, 1)) {
+		return;
+	}
+
+	series[series_count] = *env_sample;
+	series_timestamps[series_count] = timestamp;
+	series_count++;
+
+	/* Deadbands are evaluated against the last buffered sample */
+	sample_sent(env_sample);
+
+	if (series_count < ARRAY_SIZE(series)) {
+		LOG_DBG("Sample buffered, %zu of %zu", series_count, ARRAY_SIZE(series));
+		return;
+	}
+
+	series_send();
+}
+
+static void sample(void)
+{
+	struct env_sample env_sample;
+	int32_t timestamp;
+
+	if (sample_get(&env_sample, NULL) || timestamp_get(&timestamp)) {
+		return;
+	}
+
+	sample_add(&env_sample, timestamp);
+}
+#else
+static void local_sampling_start(void)
+{
+}
+
+/* The base name and time are sent with the first record */
+#define RECORD_BASE_SET(_record, _timestamp)	\
+	do {					\
+		(_record).bn_present = true;	\
+		(_record).bt_present = true;	\
+		(_record).bt.bt = (_timestamp);	\
+	} while (0)
+
+static void sample_add(const struct env_sample *env_sample, int32_t timestamp)
+{
+	struct payload payload = { 0 };
+	struct env_object env_obj = { 0 };
+	uint32_t start;
+	int ret;
+
+	if (!resource_enabled(ENV_RESOURCES_ALL)) {
+		LOG_DBG("No resources enabled, sample not sent");
+		return;
+	}
+
+	if (!send_due(env_sample, 1)) {
+		return;
+	}
+
+	start = k_cycle_get_32();
+
+	if (resource_enabled(ENV_RESOURCE_TEMPERATURE)) {
+		env_obj.temperature_m_present = true;
+		env_obj.temperature_m.vf = centi_to_float(env_sample->temperature);
+	}
+
+	if (resource_enabled(ENV_RESOURCE_HUMIDITY)) {
+		env_obj.humidity_m_present = true;
+		env_obj.humidity_m.vf = centi_to_float(env_sample->humidity);
+	}
+
+	if (resource_enabled(ENV_RESOURCE_PRESSURE)) {
+		env_obj.pressure_m_present = true;
+		env_obj.pressure_m.vf = centi_to_float(env_sample->pressure);
+	}
+
+	if (resource_enabled(ENV_RESOURCE_IAQ)) {
+		env_obj.iaq_m_present = true;
+		env_obj.iaq_m.vi = env_sample->iaq;
+	}
+
+	if (resource_enabled(ENV_RESOURCE_CO2)) {
+		env_obj.co2_m_present = true;
+		env_obj.co2_m.vi = env_sample->co2;
+	}
+
+	if (resource_enabled(ENV_RESOURCE_VOC)) {
+		env_obj.voc_m_present = true;
+		env_obj.voc_m.vi = env_sample->voc;
+	}
+
+	if (env_obj.temperature_m_present) {
+		RECORD_BASE_SET(env_obj.temperature_m, timestamp);
+	} else if (env_obj.humidity_m_present) {
+		RECORD_BASE_SET(env_obj.humidity_m, timestamp);
+	} else if (env_obj.pressure_m_present) {
+		RECORD_BASE_SET(env_obj.pressure_m, timestamp);
+	} else if (env_obj.iaq_m_present) {
+		RECORD_BASE_SET(env_obj.iaq_m, timestamp);
+	} else if (env_obj.co2_m_present) {
+		RECORD_BASE_SET(env_obj.co2_m, timestamp);
+	} else {
+		RECORD_BASE_SET(env_obj.voc_m, timestamp);
+	}
 
 	ret = cbor_encode_env_object(payload.buffer, sizeof(payload.buffer),
 				     &env_obj, &payload.buffer_len);
@@ -180,56 +1269,109 @@ static void sample(void)
 		return;
 	}
 
-	LOG_DBG("Submitting payload");
+	LOG_DBG("Env object encoded, %zu bytes, %u cycles", payload.buffer_len,
+		k_cycle_get_32() - start);
 
-	int err = zbus_chan_pub(&PAYLOAD_CHAN, &payload, K_SECONDS(1));
-	if (err) {
-		LOG_ERR("zbus_chan_pub, error: %d", err);
-		SEND_FATAL_ERROR();
+	payload_send(&payload);
+	sample_sent(env_sample);
+}
+
+static void sample(void)
+{
+	struct env_sample env_sample;
+	int32_t timestamp;
+
+	if (!resource_enabled(ENV_RESOURCES_ALL)) {
+		LOG_DBG("No resources enabled, sample not taken");
+		return;
+	}
+
+	if (sample_get(&env_sample, NULL) || timestamp_get(&timestamp)) {
+		return;
+	}
+
+	sample_add(&env_sample, timestamp);
+}
+#endif /* CONFIG_APP_ENVIRONMENTAL_AGGREGATION */
+
+#if defined(CONFIG_APP_ENVIRONMENTAL_AGGREGATION)
+/* Samples taken before time is available are aggregated like local samples, the aggregates
+ * are timestamped when they are reported.
+ */
+static void sample_pending(void)
+{
+	local_sample();
+}
+
+static void pending_flush(void)
+{
+}
+#else
+static void sample_pending(void)
+{
+	struct env_sample env_sample;
+
+	if (sample_get(&env_sample, NULL)) {
 		return;
 	}
+
+	pending_samples_push(&environmental_pending, &env_sample);
+}
+
+/* Samples that were taken before time was available are handled in order like samples
+ * taken now, timestamped from their uptime.
+ */
+static void pending_sample_add(const void *sample, int64_t system_time)
+{
+	sample_add(sample, (int32_t)(system_time / 1000));
+}
+
+static void pending_flush(void)
+{
+	pending_samples_flush(&environmental_pending, pending_sample_add);
 }
+#endif /* CONFIG_APP_ENVIRONMENTAL_AGGREGATION */
 
 static void environmental_task(void)
 {
 	int err;
-	int task_wdt_id;
+	int supervisor_id;
 	const uint32_t wdt_timeout_ms = (CONFIG_APP_ENVIRONMENTAL_WATCHDOG_TIMEOUT_SECONDS * MSEC_PER_SEC);
-	const uint32_t execution_time_ms = (CONFIG_APP_ENVIRONMENTAL_EXEC_TIME_SECONDS_MAX * MSEC_PER_SEC);
-	const k_timeout_t zbus_wait_ms = K_MSEC(wdt_timeout_ms - execution_time_ms);
 
 	LOG_DBG("Environmental module task started");
 
-	task_wdt_id = task_wdt_add(wdt_timeout_ms, task_wdt_callback, (void *)k_current_get());
+	supervisor_id = supervisor_add(&environmental, wdt_timeout_ms);
+	if (supervisor_id < 0) {
+		LOG_ERR("supervisor_add, error: %d", supervisor_id);
+		SEND_FATAL_ERROR();
+		return;
+	}
 
-	STATE_SET_INITIAL(STATE_INIT);
+	snapshot_init();
+
+	STATE_SET_INITIAL(STATE_RUNNING);
 
 	while (true) {
-		err = task_wdt_feed(task_wdt_id);
+		err = zbus_sub_wait_msg(&environmental, &s_obj.chan, s_obj.msg_buf, K_FOREVER);
 		if (err) {
-			LOG_ERR("task_wdt_feed, error: %d", err);
-			SEND_FATAL_ERROR();
-			return;
-		}
-
-		err = zbus_sub_wait_msg(&environmental, &s_obj.chan, s_obj.msg_buf, zbus_wait_ms);
-		if (err == -ENOMSG) {
-			continue;
-		} else if (err) {
 			LOG_ERR("zbus_sub_wait_msg, error: %d", err);
 			SEND_FATAL_ERROR();
 			return;
 		}
 
+		supervisor_checkin(supervisor_id);
+
 		err = STATE_RUN();
 		if (err) {
 			LOG_ERR("handle_message, error: %d", err);
 			SEND_FATAL_ERROR();
 			return;
 		}
+
+		supervisor_checkout(supervisor_id);
 	}
 }
 
 K_THREAD_DEFINE(environmental_task_id,
 		CONFIG_APP_ENVIRONMENTAL_THREAD_STACK_SIZE,
-		environmental_task, NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+		environmental_task, NULL, NULL, NULL, CONFIG_APP_THREAD_PRIORITY_BULK, 0, 0);
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**@file
+ *
+ * @brief   Environmental module.
+ */
+
+#ifndef ENVIRONMENTAL_H__
+#define ENVIRONMENTAL_H__
+
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Environmental sample, in fixed point with two decimals of the units used in the
+ *	   environment object.
+ */
+struct env_sample {
+	/* Hundredths of degrees Celsius */
+	int32_t temperature;
+	/* Hundredths of percent */
+	int32_t humidity;
+	/* Hundredths of hectopascals, that is pascals */
+	int32_t pressure;
+	int32_t iaq;
+	/* CO2 equivalent in ppm */
+	int32_t co2;
+	/* Breath VOC equivalent in ppb */
+	int32_t voc;
+};
+
+/** @brief Latest environmental sample. */
+struct env_snapshot {
+	struct env_sample sample;
+
+	/* Uptime when the sample was obtained from the sensor, in milliseconds */
+	int64_t uptime_ms;
+
+	/* Time spent resuming the sensor and waiting for it to warm up before the sample was
+	 * read, in milliseconds. 0 if the sensor was not suspended.
+	 */
+	uint32_t latency_ms;
+};
+
+/** @brief Get the latest environmental sample without accessing the sensor.
+ *
+ *  @note The snapshot is updated when the sensor driver has new results, or when the
+ *	  environmental module samples the sensor if the driver does not signal new results.
+ *
+ *  @param snapshot Pointer to where the snapshot is stored.
+ *
+ *  @return 0 on success, -ENODATA if no sample has been obtained yet.
+ */
+int env_snapshot_get(struct env_snapshot *snapshot);
+
+/** @brief Get the interval between local samples.
+ *
+ *  @note Only available with CONFIG_APP_ENVIRONMENTAL_AGGREGATION. With
+ *	  CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING the interval follows the activity of
+ *	  the sampled values.
+ *
+ *  @return Local sampling interval in seconds.
+ */
+uint32_t env_local_sample_interval_get(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ENVIRONMENTAL_H__ */
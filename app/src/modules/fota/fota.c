@@ -12,13 +12,13 @@
 #include <net/nrf_cloud_fota_poll.h>
 #include <zephyr/sys/reboot.h>
 #include <zephyr/dfu/mcuboot.h>
-#include <zephyr/task_wdt/task_wdt.h>
 #include <modem/nrf_modem_lib.h>
 #include <nrf_cloud_fota.h>
 #include <zephyr/smf.h>
 
 #include "message_channel.h"
 #include "modules_common.h"
+#include "supervisor.h"
 
 /* Register log module */
 LOG_MODULE_REGISTER(fota, CONFIG_APP_FOTA_LOG_LEVEL);
@@ -31,12 +31,11 @@ void fota_callback(const struct zbus_channel *chan);
 ZBUS_MSG_SUBSCRIBER_DEFINE(fota);
 
 /* Observe channels */
-ZBUS_CHAN_ADD_OBS(TRIGGER_CHAN, fota, 0);
-ZBUS_CHAN_ADD_OBS(CLOUD_CHAN, fota, 0);
-ZBUS_CHAN_ADD_OBS(NETWORK_CHAN, fota, 0);
+#define CHANNELS TRIGGER_CHAN, CLOUD_CHAN, NETWORK_CHAN
 
-#define MAX_MSG_SIZE MAX(MAX(sizeof(enum trigger_type), sizeof(enum cloud_status)), \
-			     sizeof(enum network_status))
+CHAN_ADD_OBS(fota, CHANNELS);
+
+#define MAX_MSG_SIZE CHAN_MSG_SIZE_MAX(CHANNELS)
 
 /* FOTA support context */
 static void fota_reboot(enum nrf_cloud_fota_reboot_status status);
@@ -99,6 +98,10 @@ ZBUS_CHAN_DEFINE(PRIV_FOTA_CHAN,
 		 ZBUS_MSG_INIT(0)
 );
 
+#if defined(CONFIG_APP_MODULE_TRACE)
+ZBUS_CHAN_ADD_OBS(PRIV_FOTA_CHAN, module_trace, 0);
+#endif
+
 
 /* Forward declarations */
 static void state_running_entry(void *o);
@@ -372,14 +375,6 @@ static void state_reboot_pending_entry(void *o)
 
 /* End of state handlers */
 
-static void task_wdt_callback(int channel_id, void *user_data)
-{
-	LOG_ERR("Watchdog expired, Channel: %d, Thread: %s",
-		channel_id, k_thread_name_get((k_tid_t)user_data));
-
-	SEND_FATAL_ERROR_WATCHDOG_TIMEOUT();
-}
-
 static void fota_reboot(enum nrf_cloud_fota_reboot_status status)
 {
 	int err;
@@ -471,43 +466,41 @@ static void fota_status(enum nrf_cloud_fota_status status, const char *const sta
 static void fota_task(void)
 {
 	int err;
-	int task_wdt_id;
+	int supervisor_id;
 	const uint32_t wdt_timeout_ms = (CONFIG_APP_FOTA_WATCHDOG_TIMEOUT_SECONDS * MSEC_PER_SEC);
-	const uint32_t execution_time_ms = (CONFIG_APP_FOTA_EXEC_TIME_SECONDS_MAX * MSEC_PER_SEC);
-	const k_timeout_t zbus_wait_ms = K_MSEC(wdt_timeout_ms - execution_time_ms);
 
 	LOG_DBG("FOTA module task started");
 
-	task_wdt_id = task_wdt_add(wdt_timeout_ms, task_wdt_callback, (void *)k_current_get());
+	supervisor_id = supervisor_add(&fota, wdt_timeout_ms);
+	if (supervisor_id < 0) {
+		LOG_ERR("supervisor_add, error: %d", supervisor_id);
+		SEND_FATAL_ERROR();
+		return;
+	}
 
 	STATE_SET_INITIAL(STATE_RUNNING);
 
 	while (true) {
-		err = task_wdt_feed(task_wdt_id);
+		err = zbus_sub_wait_msg(&fota, &s_obj.chan, s_obj.msg_buf, K_FOREVER);
 		if (err) {
-			LOG_ERR("task_wdt_feed, error: %d", err);
-			SEND_FATAL_ERROR();
-			return;
-		}
-
-		err = zbus_sub_wait_msg(&fota, &s_obj.chan, s_obj.msg_buf, zbus_wait_ms);
-		if (err == -ENOMSG) {
-			continue;
-		} else if (err) {
 			LOG_ERR("zbus_sub_wait_msg, error: %d", err);
 			SEND_FATAL_ERROR();
 			return;
 		}
 
+		supervisor_checkin(supervisor_id);
+
 		err = STATE_RUN();
 		if (err) {
 			LOG_ERR("handle_message, error: %d", err);
 			SEND_FATAL_ERROR();
 			return;
 		}
+
+		supervisor_checkout(supervisor_id);
 	}
 }
 
 K_THREAD_DEFINE(fota_task_id,
 		CONFIG_APP_FOTA_THREAD_STACK_SIZE,
-		fota_task, NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO - 1, 0, 0);
+		fota_task, NULL, NULL, NULL, CONFIG_APP_THREAD_PRIORITY_NORMAL, 0, 0);
@@ -10,6 +10,7 @@
 #include <zephyr/smf.h>
 
 #include "message_channel.h"
+#include "module_trace.h"
 #include "led_pwm.h"
 #include "led.h"
 
@@ -24,12 +25,8 @@ void led_callback(const struct zbus_channel *chan);
 ZBUS_LISTENER_DEFINE(led, led_callback);
 
 /* Observe channels */
-ZBUS_CHAN_ADD_OBS(ERROR_CHAN, led, 0);
-ZBUS_CHAN_ADD_OBS(CONFIG_CHAN, led, 0);
-ZBUS_CHAN_ADD_OBS(NETWORK_CHAN, led, 0);
-ZBUS_CHAN_ADD_OBS(TRIGGER_MODE_CHAN, led, 0);
-ZBUS_CHAN_ADD_OBS(LOCATION_CHAN, led, 0);
-ZBUS_CHAN_ADD_OBS(FOTA_STATUS_CHAN, led, 0);
+CHAN_ADD_OBS(led, ERROR_CHAN, LED_CONFIG_CHAN, NETWORK_CHAN, TRIGGER_MODE_CHAN, LOCATION_CHAN,
+	     FOTA_STATUS_CHAN);
 
 /* Zephyr SMF states */
 enum state {
@@ -170,11 +167,14 @@ static void led_pattern_update_work_fn(struct k_work *work)
 	int err;
 	struct led_pattern *next_pattern;
 	static enum led_state previous_led_state = LED_PATTERN_COUNT;
-	sys_snode_t *node = sys_slist_get(&pattern_transition_list);
+	sys_snode_t *node;
 
+	MODULE_TRACE_WORK_BEGIN();
+
+	node = sys_slist_get(&pattern_transition_list);
 	if (node == NULL) {
 		LOG_ERR("Cannot find any more LED pattern transitions");
-		return;
+		goto exit;
 	}
 
 	next_pattern = CONTAINER_OF(node, struct led_pattern, header);
@@ -196,7 +196,7 @@ static void led_pattern_update_work_fn(struct k_work *work)
 			if (err) {
 				LOG_ERR("Failed to set LED configuration");
 				SEND_FATAL_ERROR();
-				return;
+				goto exit;
 			}
 
 		} else {
@@ -207,7 +207,7 @@ static void led_pattern_update_work_fn(struct k_work *work)
 			if (err) {
 				LOG_ERR("Failed to set LED effect");
 				SEND_FATAL_ERROR();
-				return;
+				goto exit;
 			}
 		}
 
@@ -221,6 +221,9 @@ static void led_pattern_update_work_fn(struct k_work *work)
 	if (next_pattern->duration_sec > 0) {
 		k_work_reschedule(&led_pattern_update_work, K_SECONDS(next_pattern->duration_sec));
 	}
+
+exit:
+	MODULE_TRACE_WORK_END();
 }
 
 static bool is_rgb_off(uint8_t red, uint8_t green, uint8_t blue)
@@ -270,8 +273,15 @@ static enum smf_state_result running_run(void *o)
 
 	if (&NETWORK_CHAN == user_object->chan && user_object->status == NETWORK_CONNECTED) {
 
-		/* If the network is connected, we just reenter the same state */
-		smf_set_state(SMF_CTX(user_object), &states[STATE_RUNNING]);
+		/* If the network is connected, we reenter the same state. The configured color is
+		 * restored directly, as it is not published again unless it changes.
+		 */
+		if (!is_rgb_off(user_object->red, user_object->green, user_object->blue)) {
+			smf_set_state(SMF_CTX(user_object), &states[STATE_LED_SET]);
+		} else {
+			smf_set_state(SMF_CTX(user_object), &states[STATE_RUNNING]);
+		}
+
 		return SMF_EVENT_HANDLED;
 	}
 
@@ -302,7 +312,7 @@ static enum smf_state_result led_set_running(void *o)
 
 	LOG_DBG("led_set_running");
 
-	if ((&CONFIG_CHAN == user_object->chan) &&
+	if ((&LED_CONFIG_CHAN == user_object->chan) &&
 	    is_rgb_off(user_object->red, user_object->green, user_object->blue)) {
 
 		if (user_object->mode == TRIGGER_MODE_NORMAL) {
@@ -314,7 +324,7 @@ static enum smf_state_result led_set_running(void *o)
 		}
 	}
 
-	if ((&CONFIG_CHAN == user_object->chan) &&
+	if ((&LED_CONFIG_CHAN == user_object->chan) &&
 	    !is_rgb_off(user_object->red, user_object->green, user_object->blue)) {
 
 		smf_set_state(SMF_CTX(user_object), &states[STATE_LED_SET]);
@@ -332,7 +342,7 @@ static enum smf_state_result led_not_set_running(void *o)
 
 	LOG_DBG("led_not_set_running");
 
-	if ((&CONFIG_CHAN == user_object->chan) &&
+	if ((&LED_CONFIG_CHAN == user_object->chan) &&
 	    !is_rgb_off(user_object->red, user_object->green, user_object->blue)) {
 
 		smf_set_state(SMF_CTX(user_object), &states[STATE_LED_SET]);
@@ -554,46 +564,55 @@ void led_callback(const struct zbus_channel *chan)
 	state_object.chan = chan;
 
 	/* Update the state object with the message received on the channel */
-	if (&TRIGGER_MODE_CHAN == chan) {
+	switch (CHAN_ID(chan)) {
+	case CHAN_ID_TRIGGER_MODE_CHAN: {
 		const enum trigger_mode *mode = zbus_chan_const_msg(chan);
 
 		state_object.mode = *mode;
+		break;
 	}
-
-	if (&NETWORK_CHAN == chan) {
+	case CHAN_ID_NETWORK_CHAN: {
 		const enum network_status *status = zbus_chan_const_msg(chan);
 
 		state_object.status = *status;
+		break;
 	}
-
-	if (&LOCATION_CHAN == chan) {
+	case CHAN_ID_LOCATION_CHAN: {
 		const enum location_status *status = zbus_chan_const_msg(chan);
 
 		state_object.location_status = *status;
+		break;
 	}
-
-	if (&CONFIG_CHAN == chan) {
+	case CHAN_ID_LED_CONFIG_CHAN: {
 		/* Get LED configuration from channel. */
 
-		const struct configuration *config = zbus_chan_const_msg(chan);
-
-		if (config->led_present == false) {
-			LOG_DBG("LED configuration not present");
-			return;
-		}
+		const struct led_configuration *config = zbus_chan_const_msg(chan);
+		uint8_t red;
+		uint8_t green;
+		uint8_t blue;
 
 		/* Set the changed incoming color, if a color is not present,
 		 * the old value will be used
 		 */
-		state_object.red = (config->led_red_present) ?
-				    (uint8_t)config->led_red : state_object.red;
-		state_object.green = (config->led_green_present) ?
-				      (uint8_t)config->led_green : state_object.green;
-		state_object.blue = (config->led_blue_present) ?
-				     (uint8_t)config->led_blue : state_object.blue;
-	}
+		red = (config->red_present) ? (uint8_t)config->red : state_object.red;
+		green = (config->green_present) ? (uint8_t)config->green : state_object.green;
+		blue = (config->blue_present) ? (uint8_t)config->blue : state_object.blue;
+
+		/* The displayed pattern only depends on the color, leave it and any running
+		 * effect untouched if the color is the same.
+		 */
+		if ((red == state_object.red) && (green == state_object.green) &&
+		    (blue == state_object.blue)) {
+			LOG_DBG("LED color unchanged");
+			return;
+		}
 
-	if (&ERROR_CHAN == chan) {
+		state_object.red = red;
+		state_object.green = green;
+		state_object.blue = blue;
+		break;
+	}
+	case CHAN_ID_ERROR_CHAN: {
 		const enum error_type *type = zbus_chan_const_msg(chan);
 
 		if (*type != ERROR_FATAL && *type != ERROR_IRRECOVERABLE) {
@@ -602,6 +621,10 @@ void led_callback(const struct zbus_channel *chan)
 		}
 
 		state_object.type = *type;
+		break;
+	}
+	default:
+		break;
 	}
 
 	/* State object updated, run SMF */
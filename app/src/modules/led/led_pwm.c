@@ -13,6 +13,7 @@
 #include "led.h"
 #include "led_pwm.h"
 #include "led_effect.h"
+#include "module_trace.h"
 
 LOG_MODULE_REGISTER(app_led_pwm, CONFIG_APP_LED_LOG_LEVEL);
 
@@ -158,6 +159,8 @@ static void work_handler(struct k_work *work)
 		return;
 	}
 
+	MODULE_TRACE_WORK_BEGIN();
+
 	const struct led_effect_step *effect_step =
 		&leds.effect->steps[leds.effect_step];
 	int substeps_left = effect_step->substep_cnt - leds.effect_substep;
@@ -190,6 +193,8 @@ static void work_handler(struct k_work *work)
 
 		k_work_reschedule_for_queue(&led_pwm_queue, &leds.work, K_MSEC(next_delay));
 	}
+
+	MODULE_TRACE_WORK_END();
 }
 
 static int led_update(struct led *led)
@@ -255,6 +260,9 @@ int led_pwm_set_effect(enum led_state state)
 			LOG_ERR("Failed to start leds pwm, led_pwm_start: %d.", err);
 			return err;
 		}
+	} else if (leds.effect == &effect[state]) {
+		LOG_DBG("Effect already running");
+		return 0;
 	}
 
 	leds.effect = &effect[state];
@@ -302,6 +310,12 @@ int led_pwm_set_rgb(uint8_t red, uint8_t green, uint8_t blue)
 			LOG_ERR("Failed to start leds pwm, led_pwm_start: %d.", err);
 			return err;
 		}
+	} else if ((leds.effect == &effect_on) &&
+		   (effect_on.steps[0].color.c[0] == red) &&
+		   (effect_on.steps[0].color.c[1] == green) &&
+		   (effect_on.steps[0].color.c[2] == blue)) {
+		LOG_DBG("Color already set");
+		return 0;
 	}
 
 	effect_on.steps[0].color.c[0] = red;
@@ -324,7 +338,7 @@ static int led_pwm_init(void)
 	k_work_queue_init(&led_pwm_queue);
 	k_work_queue_start(&led_pwm_queue, stack_area,
 			   K_THREAD_STACK_SIZEOF(stack_area),
-			   K_LOWEST_APPLICATION_THREAD_PRIO,
+			   CONFIG_APP_THREAD_PRIORITY_BULK,
 			   NULL);
 	k_thread_name_set(&led_pwm_queue.thread, "led_pwm_workq");
 
@@ -6,7 +6,6 @@
 
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
-#include <zephyr/task_wdt/task_wdt.h>
 #include <zephyr/zbus/zbus.h>
 #include <zephyr/init.h>
 
@@ -15,45 +14,32 @@
 #include <date_time.h>
 
 #include "message_channel.h"
+#include "supervisor.h"
 #include "modem/lte_lc.h"
 
 #include <net/nrf_cloud.h>
 
 LOG_MODULE_REGISTER(location_module, CONFIG_APP_LOCATION_LOG_LEVEL);
 
-BUILD_ASSERT(CONFIG_APP_LOCATION_WATCHDOG_TIMEOUT_SECONDS >
-	     CONFIG_APP_LOCATION_ZBUS_TIMEOUT_SECONDS,
-	     "Watchdog timeout must be greater than trigger timeout");
-
 /* Define listener for this module */
 ZBUS_MSG_SUBSCRIBER_DEFINE(location);
 
 /* Observe channels */
-ZBUS_CHAN_ADD_OBS(TRIGGER_CHAN, location, 0);
-ZBUS_CHAN_ADD_OBS(CLOUD_CHAN, location, 0);
-ZBUS_CHAN_ADD_OBS(CONFIG_CHAN, location, 0);
-ZBUS_CHAN_ADD_OBS(NETWORK_CHAN, location, 0);
+#define CHANNELS TRIGGER_CHAN, CLOUD_CHAN, APP_CONFIG_CHAN, NETWORK_CHAN
+
+CHAN_ADD_OBS(location, CHANNELS);
 
-#define MAX_MSG_SIZE \
-	(MAX(sizeof(enum trigger_type), \
-		 (MAX(sizeof(enum cloud_status), \
-		     (MAX(sizeof(struct configuration), \
-		         sizeof(enum network_status)))))))
+#define MAX_MSG_SIZE CHAN_MSG_SIZE_MAX(CHANNELS)
 
 static bool gnss_enabled;
 
+/* Timeout of the entire location request, the library default is used if zero */
+static uint32_t location_timeout_sec;
+
 static void location_event_handler(const struct location_event_data *event_data);
 
 int nrf_cloud_coap_location_send(const struct nrf_cloud_gnss_data *gnss, bool confirmable);
 
-static void task_wdt_callback(int channel_id, void *user_data)
-{
-	LOG_ERR("Watchdog expired, Channel: %d, Thread: %s",
-		channel_id, k_thread_name_get((k_tid_t)user_data));
-
-	SEND_FATAL_ERROR_WATCHDOG_TIMEOUT();
-}
-
 static enum location_method location_method_types[] = {
 	LOCATION_METHOD_GNSS,
 	LOCATION_METHOD_WIFI,
@@ -88,6 +74,10 @@ void trigger_location_update(void)
 		LOG_DBG("GNSS disabled");
 	}
 
+	if (location_timeout_sec) {
+		config.timeout = location_timeout_sec * MSEC_PER_SEC;
+	}
+
 	LOG_DBG("location library initialized");
 
 	err = location_request(&config);
@@ -126,13 +116,16 @@ void handle_trigger_chan(enum trigger_type trigger_type)
 	}
 }
 
-void handle_config_chan(const struct configuration *config)
+void handle_config_chan(const struct app_configuration *config)
 {
-	if (config->config_present && config->gnss_present) {
+	if (config->gnss_present) {
 		gnss_enabled = config->gnss;
 		LOG_DBG("GNSS enabled: %d", gnss_enabled);
-	} else {
-		LOG_DBG("Configuration not present");
+	}
+
+	if (config->location_timeout_present) {
+		location_timeout_sec = config->location_timeout;
+		LOG_DBG("Location timeout: %d seconds", location_timeout_sec);
 	}
 }
 
@@ -165,16 +158,15 @@ void location_task(void)
 {
 	int err = 0;
 	const struct zbus_channel *chan;
-	int task_wdt_id;
+	int supervisor_id;
 	const uint32_t wdt_timeout_ms = (CONFIG_APP_LOCATION_WATCHDOG_TIMEOUT_SECONDS * MSEC_PER_SEC);
-	const k_timeout_t zbus_timeout = K_SECONDS(CONFIG_APP_LOCATION_ZBUS_TIMEOUT_SECONDS);
 	uint8_t msg_buf[MAX_MSG_SIZE];
 
 	LOG_DBG("Location module task started");
 
-	task_wdt_id = task_wdt_add(wdt_timeout_ms, task_wdt_callback, (void *)k_current_get());
-	if (task_wdt_id < 0) {
-		LOG_ERR("Failed to add task to watchdog: %d", task_wdt_id);
+	supervisor_id = supervisor_add(&location, wdt_timeout_ms);
+	if (supervisor_id < 0) {
+		LOG_ERR("Failed to add task to supervisor: %d", supervisor_id);
 		SEND_FATAL_ERROR();
 		return;
 	}
@@ -189,42 +181,39 @@ void location_task(void)
 	LOG_DBG("location library initialized");
 
 	while (true) {
-		err = task_wdt_feed(task_wdt_id);
+		err = zbus_sub_wait_msg(&location, &chan, &msg_buf, K_FOREVER);
 		if (err) {
-			LOG_ERR("Failed to feed the watchdog: %d", err);
-			SEND_FATAL_ERROR();
-			return;
-		}
-
-		err = zbus_sub_wait_msg(&location, &chan, &msg_buf, zbus_timeout);
-		if (err == -ENOMSG) {
-			continue;
-		} else if (err) {
 			LOG_ERR("zbus_sub_wait, error: %d", err);
 			SEND_FATAL_ERROR();
 			return;
 		}
 
-		if (&NETWORK_CHAN == chan) {
+		supervisor_checkin(supervisor_id);
+
+		switch (CHAN_ID(chan)) {
+		case CHAN_ID_NETWORK_CHAN:
 			LOG_DBG("Network status received");
 			handle_network_chan(MSG_TO_NETWORK_STATUS(&msg_buf));
-		}
-
-		if (&TRIGGER_CHAN == chan) {
+			break;
+		case CHAN_ID_TRIGGER_CHAN:
 			LOG_DBG("Trigger received");
 			handle_trigger_chan(MSG_TO_TRIGGER_TYPE(&msg_buf));
-		}
-
-		if (&CONFIG_CHAN == chan) {
+			break;
+		case CHAN_ID_APP_CONFIG_CHAN:
 			LOG_DBG("Configuration received");
-			handle_config_chan(MSG_TO_CONFIGURATION(&msg_buf));
+			handle_config_chan(MSG_TO_APP_CONFIGURATION(&msg_buf));
+			break;
+		default:
+			break;
 		}
+
+		supervisor_checkout(supervisor_id);
 	}
 }
 
 K_THREAD_DEFINE(location_module_tid, CONFIG_APP_LOCATION_THREAD_STACK_SIZE,
 		location_task, NULL, NULL, NULL,
-		K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+		CONFIG_APP_THREAD_PRIORITY_NORMAL, 0, 0);
 
 /* Take time from PVT data and apply it to system time. */
 static void apply_gnss_time(const struct nrf_modem_gnss_pvt_data_frame *pvt_data)
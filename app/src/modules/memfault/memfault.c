@@ -6,7 +6,6 @@
 
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
-#include <zephyr/task_wdt/task_wdt.h>
 #include <zephyr/zbus/zbus.h>
 #include "memfault/components.h"
 #include <memfault/ports/zephyr/http.h>
@@ -18,6 +17,7 @@
 #include <modem/nrf_modem_lib.h>
 
 #include "message_channel.h"
+#include "supervisor.h"
 
 LOG_MODULE_REGISTER(memfault, CONFIG_APP_MEMFAULT_LOG_LEVEL);
 
@@ -25,17 +25,11 @@ LOG_MODULE_REGISTER(memfault, CONFIG_APP_MEMFAULT_LOG_LEVEL);
 ZBUS_MSG_SUBSCRIBER_DEFINE(memfault);
 
 /* Observe channels */
-ZBUS_CHAN_ADD_OBS(CLOUD_CHAN, memfault, 0);
+#define CHANNELS CLOUD_CHAN
 
-#define MAX_MSG_SIZE sizeof(enum cloud_status)
+CHAN_ADD_OBS(memfault, CHANNELS);
 
-static void task_wdt_callback(int channel_id, void *user_data)
-{
-	LOG_ERR("Watchdog expired, Channel: %d, Thread: %s",
-		channel_id, k_thread_name_get((k_tid_t)user_data));
-
-	SEND_FATAL_ERROR_WATCHDOG_TIMEOUT();
-}
+#define MAX_MSG_SIZE CHAN_MSG_SIZE_MAX(CHANNELS)
 
 #if defined(CONFIG_APP_MEMFAULT_INCLUDE_MODEM_TRACES)
 
@@ -206,44 +200,42 @@ void memfault_task(void)
 {
 	int err;
 	const struct zbus_channel *chan;
-	int task_wdt_id;
+	int supervisor_id;
 	const uint32_t wdt_timeout_ms = (CONFIG_APP_MEMFAULT_WATCHDOG_TIMEOUT_SECONDS * MSEC_PER_SEC);
-	const k_timeout_t zbus_timeout = K_SECONDS(CONFIG_APP_MEMFAULT_ZBUS_TIMEOUT_SECONDS);
 	uint8_t msg_buf[MAX_MSG_SIZE];
 
 	LOG_DBG("Memfault module task started");
 
-	task_wdt_id = task_wdt_add(wdt_timeout_ms, task_wdt_callback, (void *)k_current_get());
-	if (task_wdt_id < 0) {
-		LOG_ERR("Failed to add task to watchdog: %d", task_wdt_id);
+	supervisor_id = supervisor_add(&memfault, wdt_timeout_ms);
+	if (supervisor_id < 0) {
+		LOG_ERR("Failed to add task to supervisor: %d", supervisor_id);
 		SEND_FATAL_ERROR();
 		return;
 	}
 
 	while (true) {
-		err = task_wdt_feed(task_wdt_id);
+		err = zbus_sub_wait_msg(&memfault, &chan, &msg_buf, K_FOREVER);
 		if (err) {
-			LOG_ERR("Failed to feed the watchdog: %d", err);
-			SEND_FATAL_ERROR();
-			return;
-		}
-
-		err = zbus_sub_wait_msg(&memfault, &chan, &msg_buf, zbus_timeout);
-		if (err == -ENOMSG) {
-			continue;
-		} else if (err) {
 			LOG_ERR("zbus_sub_wait, error: %d", err);
 			SEND_FATAL_ERROR();
 			return;
 		}
 
-		if (&CLOUD_CHAN == chan) {
+		supervisor_checkin(supervisor_id);
+
+		switch (CHAN_ID(chan)) {
+		case CHAN_ID_CLOUD_CHAN:
 			LOG_DBG("Cloud status received");
 			handle_cloud_chan(MSG_TO_CLOUD_STATUS(&msg_buf));
+			break;
+		default:
+			break;
 		}
+
+		supervisor_checkout(supervisor_id);
 	}
 }
 
 K_THREAD_DEFINE(memfault_module_tid, CONFIG_APP_MEMFAULT_THREAD_STACK_SIZE,
 		memfault_task, NULL, NULL, NULL,
-		K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+		CONFIG_APP_THREAD_PRIORITY_BULK, 0, 0);
@@ -9,13 +9,14 @@
 #include <zephyr/zbus/zbus.h>
 #include <zephyr/net/conn_mgr_connectivity.h>
 #include <zephyr/net/conn_mgr_monitor.h>
-#include <zephyr/task_wdt/task_wdt.h>
 #include <date_time.h>
 #include <zephyr/smf.h>
 
 #include "modem/lte_lc.h"
 #include "modem/modem_info.h"
 #include "modules_common.h"
+#include "supervisor.h"
+#include "pending_samples.h"
 #include "conn_info_object_encode.h"
 #include "message_channel.h"
 
@@ -26,12 +27,11 @@ LOG_MODULE_REGISTER(network, CONFIG_APP_NETWORK_LOG_LEVEL);
 ZBUS_MSG_SUBSCRIBER_DEFINE(network);
 
 /* Observe trigger channel */
-ZBUS_CHAN_ADD_OBS(TRIGGER_CHAN, network, 0);
-ZBUS_CHAN_ADD_OBS(TIME_CHAN, network, 0);
-ZBUS_CHAN_ADD_OBS(NETWORK_CHAN, network, 0);
+#define CHANNELS TRIGGER_CHAN, TIME_CHAN, NETWORK_CHAN
 
-#define MAX_MSG_SIZE (MAX(MAX(sizeof(enum trigger_type), sizeof(enum time_status)), \
-			      sizeof(enum network_status)))
+CHAN_ADD_OBS(network, CHANNELS);
+
+#define MAX_MSG_SIZE CHAN_MSG_SIZE_MAX(CHANNELS)
 
 /* Macros used to subscribe to specific Zephyr NET management events. */
 #define L4_EVENT_MASK (NET_EVENT_L4_CONNECTED | NET_EVENT_L4_DISCONNECTED)
@@ -41,12 +41,21 @@ ZBUS_CHAN_ADD_OBS(NETWORK_CHAN, network, 0);
 static struct net_mgmt_event_callback l4_cb;
 static struct net_mgmt_event_callback conn_cb;
 
+/* Network quality values of a sample */
+struct quality_sample {
+	int energy_estimate;
+	int rsrp;
+};
+
+/* Network quality samples taken before time was available */
+PENDING_SAMPLES_DEFINE(network_pending, struct quality_sample);
 
 /* State machine */
 
 /* Module states.
  *
- * STATE_INIT: The module is initializing and waiting for time to be available.
+ * STATE_INIT: The module is initializing and waiting for time to be available. Network
+ *	       quality samples are kept with their uptime until then.
  * STATE_SAMPLING: The module is ready to sample upon receiving a trigger.
  * STATE_DISCONNECTED: The module is disconnected from the network, sampling is blocked.
  */
@@ -72,6 +81,7 @@ struct s_object {
 };
 /* Forward declarations of state handlers */
 static enum smf_state_result state_init_run(void *o);
+static void state_sampling_entry(void *o);
 static enum smf_state_result state_sampling_run(void *o);
 static void state_disconnected_entry(void *o);
 static enum smf_state_result state_wait_for_network_disconnect_run(void *o);
@@ -83,7 +93,7 @@ static const struct smf_state states[] = {
 				 NULL,	/* No parent state */
 				 NULL), /* No initial transition */
 	[STATE_SAMPLING] =
-		SMF_CREATE_STATE(NULL, state_sampling_run, NULL,
+		SMF_CREATE_STATE(state_sampling_entry, state_sampling_run, NULL,
 				 NULL,
 				 NULL),
 	[STATE_WAIT_FOR_NETWORK_DISCONNECT] =
@@ -165,42 +175,44 @@ static void lte_lc_evt_handler(const struct lte_lc_evt *const evt)
 }
 #endif /* IS_ENABLED(CONFIG_LTE_LINK_CONTROL) */
 
-static void sample_network_quality(void)
+static int network_quality_get(struct quality_sample *quality)
 {
-	int64_t system_time;
-	struct payload payload = { 0 };
-	struct conn_info_object conn_info_obj = { 0 };
 	int ret;
-
 	struct lte_lc_conn_eval_params conn_eval_params;
 
 	ret = lte_lc_conn_eval_params_get(&conn_eval_params);
 	if (ret == -EOPNOTSUPP) {
 		LOG_WRN("Connection evaluation not supported in current functional mode");
-		return;
+		return ret;
 	} else if (ret < 0) {
 		LOG_ERR("lte_lc_conn_eval_params_get, error: %d", ret);
 		SEND_FATAL_ERROR();
-		return;
+		return ret;
 	} else if (ret > 0) {
 		LOG_WRN("Connection evaluation failed due to a network related reason: %d", ret);
-		return;
+		return -EAGAIN;
 	}
 
-	ret = date_time_now(&system_time);
-	if (ret) {
-		LOG_ERR("Failed to convert uptime to unix time, error: %d", ret);
-		return;
-	}
+	quality->energy_estimate = conn_eval_params.energy_estimate;
+	quality->rsrp = conn_eval_params.rsrp;
+
+	return 0;
+}
+
+static void network_quality_send(const struct quality_sample *quality, int64_t system_time)
+{
+	struct payload payload = { 0 };
+	struct conn_info_object conn_info_obj = { 0 };
+	int ret;
 
 	conn_info_obj.base_attributes_m.bt = (int32_t)(system_time / 1000);
-	conn_info_obj.energy_estimate_m.vi = conn_eval_params.energy_estimate;
+	conn_info_obj.energy_estimate_m.vi = quality->energy_estimate;
 
-	if (conn_eval_params.rsrp == LTE_LC_CELL_RSRP_INVALID) {
+	if (quality->rsrp == LTE_LC_CELL_RSRP_INVALID) {
 		LOG_WRN("RSRP value is invalid, ignoring");
 	} else {
 		conn_info_obj.rsrp_m.vi_present = true;
-		conn_info_obj.rsrp_m.vi.vi = RSRP_IDX_TO_DBM(conn_eval_params.rsrp);
+		conn_info_obj.rsrp_m.vi.vi = RSRP_IDX_TO_DBM(quality->rsrp);
 
 		LOG_DBG("RSRP: %d dBm", conn_info_obj.rsrp_m.vi.vi);
 	}
@@ -226,6 +238,49 @@ static void sample_network_quality(void)
 	}
 }
 
+static void sample_network_quality(void)
+{
+	int64_t system_time;
+	struct quality_sample quality;
+	int ret;
+
+	if (network_quality_get(&quality)) {
+		return;
+	}
+
+	ret = date_time_now(&system_time);
+	if (ret) {
+		LOG_ERR("Failed to convert uptime to unix time, error: %d", ret);
+		return;
+	}
+
+	network_quality_send(&quality, system_time);
+}
+
+/* Network quality samples taken before time is available are kept and sent with a timestamp
+ * derived from their uptime once it is.
+ */
+static void sample_network_quality_pending(void)
+{
+	struct quality_sample quality;
+
+	if (network_quality_get(&quality)) {
+		return;
+	}
+
+	pending_samples_push(&network_pending, &quality);
+}
+
+static void pending_quality_send(const void *sample, int64_t system_time)
+{
+	network_quality_send(sample, system_time);
+}
+
+static void pending_flush(void)
+{
+	pending_samples_flush(&network_pending, pending_quality_send);
+}
+
 /* State handlers */
 
 static enum smf_state_result state_init_run(void *obj)
@@ -243,9 +298,27 @@ static enum smf_state_result state_init_run(void *obj)
 		}
 	}
 
+	if (&TRIGGER_CHAN == state_object->chan) {
+		enum trigger_type trigger_type = MSG_TO_TRIGGER_TYPE(state_object->msg_buf);
+
+		if (trigger_type == TRIGGER_DATA_SAMPLE) {
+			LOG_DBG("Data sample trigger received before time is available");
+
+			if (IS_ENABLED(CONFIG_APP_NETWORK_SAMPLE_NETWORK_QUALITY)) {
+				sample_network_quality_pending();
+			}
+		}
+	}
+
 	return SMF_EVENT_PROPAGATE;
 }
 
+static void state_sampling_entry(void *obj)
+{
+	ARG_UNUSED(obj);
+
+	pending_flush();
+}
 
 static enum smf_state_result state_sampling_run(void *obj)
 {
@@ -309,14 +382,6 @@ static void state_disconnected_entry(void *obj)
 	LOG_DBG("state_disconnected_entry");
 }
 
-static void task_wdt_callback(int channel_id, void *user_data)
-{
-	LOG_ERR("Watchdog expired, Channel: %d, Thread: %s",
-		channel_id, k_thread_name_get((k_tid_t)user_data));
-
-	SEND_FATAL_ERROR_WATCHDOG_TIMEOUT();
-}
-
 
 static void network_task(void)
 {
@@ -379,38 +444,36 @@ static void network_task(void)
 	}
 
 	const uint32_t wdt_timeout_ms = (CONFIG_APP_NETWORK_WATCHDOG_TIMEOUT_SECONDS * MSEC_PER_SEC);
-	const uint32_t execution_time_ms = (CONFIG_APP_NETWORK_EXEC_TIME_SECONDS_MAX * MSEC_PER_SEC);
-	const k_timeout_t zbus_wait_ms = K_MSEC(wdt_timeout_ms - execution_time_ms);
-	int task_wdt_id;
+	int supervisor_id;
 
-	task_wdt_id = task_wdt_add(wdt_timeout_ms, task_wdt_callback, (void *)k_current_get());
+	supervisor_id = supervisor_add(&network, wdt_timeout_ms);
+	if (supervisor_id < 0) {
+		LOG_ERR("supervisor_add, error: %d", supervisor_id);
+		SEND_FATAL_ERROR();
+		return;
+	}
 
 	while (true) {
-		err = task_wdt_feed(task_wdt_id);
+		err = zbus_sub_wait_msg(&network, &s_obj.chan, s_obj.msg_buf, K_FOREVER);
 		if (err) {
-			LOG_ERR("task_wdt_feed, error: %d", err);
-			SEND_FATAL_ERROR();
-			return;
-		}
-
-		err = zbus_sub_wait_msg(&network, &s_obj.chan, s_obj.msg_buf, zbus_wait_ms);
-		if (err == -ENOMSG) {
-			continue;
-		} else if (err) {
 			LOG_ERR("zbus_sub_wait_msg, error: %d", err);
 			SEND_FATAL_ERROR();
 			return;
 		}
 
+		supervisor_checkin(supervisor_id);
+
 		err = STATE_RUN();
 		if (err) {
 			LOG_ERR("handle_message, error: %d", err);
 			SEND_FATAL_ERROR();
 			return;
 		}
+
+		supervisor_checkout(supervisor_id);
 	}
 }
 
 K_THREAD_DEFINE(network_task_id,
 		CONFIG_APP_NETWORK_THREAD_STACK_SIZE,
-		network_task, NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+		network_task, NULL, NULL, NULL, CONFIG_APP_THREAD_PRIORITY_NORMAL, 0, 0);
@@ -16,10 +16,15 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/zbus/zbus.h>
 #include <date_time.h>
-#include <zephyr/task_wdt/task_wdt.h>
 #include <modem/nrf_modem_lib_trace.h>
 
 #include "message_channel.h"
+#include "supervisor.h"
+#include "module_trace.h"
+
+#if defined(CONFIG_APP_ENVIRONMENTAL)
+#include "environmental.h"
+#endif /* CONFIG_APP_ENVIRONMENTAL */
 
 LOG_MODULE_REGISTER(shell, CONFIG_APP_SHELL_LOG_LEVEL);
 
@@ -35,7 +40,7 @@ static K_WORK_DELAYABLE_DEFINE(uart_enable_work, &uart_enable_handler);
 ZBUS_MSG_SUBSCRIBER_DEFINE(shell);
 
 /* Observe channels */
-ZBUS_CHAN_ADD_OBS(TRIGGER_MODE_CHAN, shell, 0);
+CHAN_ADD_OBS(shell, TRIGGER_MODE_CHAN);
 
 enum zbus_test_type {
 	PING,
@@ -60,6 +65,8 @@ static void uart_disable_handler(struct k_work *work)
 		return;
 	}
 
+	MODULE_TRACE_WORK_BEGIN();
+
 #ifdef CONFIG_NRF_MODEM_LIB_TRACE_BACKEND_UART
 	int err = nrf_modem_lib_trace_level_set(NRF_MODEM_LIB_TRACE_LEVEL_OFF);
 	if (err) {
@@ -80,10 +87,14 @@ static void uart_disable_handler(struct k_work *work)
 	if (device_is_ready(shell_uart_dev)) {
 		pm_device_action_run(shell_uart_dev, PM_DEVICE_ACTION_SUSPEND);
 	}
+
+	MODULE_TRACE_WORK_END();
 }
 
 static void uart_enable_handler(struct k_work *work)
 {
+	MODULE_TRACE_WORK_BEGIN();
+
 	if (device_is_ready(shell_uart_dev)) {
 		pm_device_action_run(shell_uart_dev, PM_DEVICE_ACTION_RESUME);
 	}
@@ -100,6 +111,8 @@ static void uart_enable_handler(struct k_work *work)
 #endif
 
 	LOG_DBG("UARTs enabled\n");
+
+	MODULE_TRACE_WORK_END();
 }
 
 
@@ -202,15 +215,44 @@ static int cmd_publish_on_payload_chan(const struct shell *sh, size_t argc,
 	return 0;
 }
 
+#if defined(CONFIG_APP_ENVIRONMENTAL)
+/* Print a value in hundredths of its unit with two decimals */
+static void print_centi(const struct shell *sh, const char *name, int32_t centi)
+{
+	shell_print(sh, "%s: %s%d.%02d", name, (centi < 0) ? "-" : "", abs(centi) / 100,
+		    abs(centi) % 100);
+}
 
-static void task_wdt_callback(int channel_id, void *user_data)
+static int cmd_env_snapshot(const struct shell *sh, size_t argc, char **argv)
 {
-	LOG_ERR("Watchdog expired, Channel: %d, Thread: %s",
-		channel_id, k_thread_name_get((k_tid_t)user_data));
+	int err;
+	struct env_snapshot snapshot;
 
-	SEND_FATAL_ERROR_WATCHDOG_TIMEOUT();
-}
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	err = env_snapshot_get(&snapshot);
+	if (err) {
+		shell_print(sh, "No sample available, error: %d", err);
+		return 1;
+	}
 
+	shell_print(sh, "Age: %lld ms", k_uptime_get() - snapshot.uptime_ms);
+	shell_print(sh, "Latency: %u ms", snapshot.latency_ms);
+	print_centi(sh, "Temperature", snapshot.sample.temperature);
+	print_centi(sh, "Humidity", snapshot.sample.humidity);
+	print_centi(sh, "Pressure", snapshot.sample.pressure);
+	shell_print(sh, "IAQ: %d", snapshot.sample.iaq);
+	shell_print(sh, "CO2: %d ppm", snapshot.sample.co2);
+	shell_print(sh, "VOC: %d ppb", snapshot.sample.voc);
+
+#if defined(CONFIG_APP_ENVIRONMENTAL_AGGREGATION)
+	shell_print(sh, "Local sampling interval: %u s", env_local_sample_interval_get());
+#endif /* CONFIG_APP_ENVIRONMENTAL_AGGREGATION */
+
+	return 0;
+}
+#endif /* CONFIG_APP_ENVIRONMENTAL */
 
 /* Handle messages from the message queue.
  * Returns 0 if the message was handled successfully, otherwise an error code.
@@ -267,39 +309,37 @@ static void shell_task(void)
 {
 	int err;
 	const struct zbus_channel *chan;
-	int task_wdt_id;
+	int supervisor_id;
 	const uint32_t wdt_timeout_ms = (CONFIG_APP_SHELL_WATCHDOG_TIMEOUT_SECONDS * MSEC_PER_SEC);
-	const uint32_t execution_time_ms = (CONFIG_APP_SHELL_EXEC_TIME_SECONDS_MAX * MSEC_PER_SEC);
-	const k_timeout_t zbus_wait_ms = K_MSEC(wdt_timeout_ms - execution_time_ms);
 	uint8_t msg_buf[MAX_MSG_SIZE];
 
 	LOG_DBG("Shell module task started");
 
-	task_wdt_id = task_wdt_add(wdt_timeout_ms, task_wdt_callback, (void *)k_current_get());
+	supervisor_id = supervisor_add(&shell, wdt_timeout_ms);
+	if (supervisor_id < 0) {
+		LOG_ERR("supervisor_add, error: %d", supervisor_id);
+		SEND_FATAL_ERROR();
+		return;
+	}
 
 	while (true) {
-		err = task_wdt_feed(task_wdt_id);
+		err = zbus_sub_wait_msg(&shell, &chan, msg_buf, K_FOREVER);
 		if (err) {
-			LOG_ERR("task_wdt_feed, error: %d", err);
-			SEND_FATAL_ERROR();
-			return;
-		}
-
-		err = zbus_sub_wait_msg(&shell, &chan, msg_buf, zbus_wait_ms);
-		if (err == -ENOMSG) {
-			continue;
-		} else if (err) {
 			LOG_ERR("zbus_sub_wait_msg, error: %d", err);
 			SEND_FATAL_ERROR();
 			return;
 		}
 
+		supervisor_checkin(supervisor_id);
+
 		err = handle_message(chan, msg_buf);
 		if (err) {
 			LOG_ERR("handle_message, error: %d", err);
 			SEND_FATAL_ERROR();
 			return;
 		}
+
+		supervisor_checkout(supervisor_id);
 	}
 
 }
@@ -328,6 +368,15 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_uart,
 
 SHELL_CMD_REGISTER(uart, &sub_uart, "UART shell", NULL);
 
+#if defined(CONFIG_APP_ENVIRONMENTAL)
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_env,
+				SHELL_CMD(snapshot, NULL, "Print the latest environmental sample", cmd_env_snapshot),
+				SHELL_SUBCMD_SET_END
+		);
+
+SHELL_CMD_REGISTER(env, &sub_env, "Environmental shell", NULL);
+#endif /* CONFIG_APP_ENVIRONMENTAL */
+
 K_THREAD_DEFINE(shell_task_id,
 		CONFIG_APP_SHELL_THREAD_STACK_SIZE,
-		shell_task, NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+		shell_task, NULL, NULL, NULL, CONFIG_APP_THREAD_PRIORITY_BULK, 0, 0);
@@ -8,30 +8,26 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/zbus/zbus.h>
 #include <zephyr/smf.h>
-#include <zephyr/task_wdt/task_wdt.h>
 #include <net/nrf_cloud.h>
 #include <net/nrf_cloud_coap.h>
 #include <app_version.h>
 
 #include "modules_common.h"
+#include "supervisor.h"
 #include "message_channel.h"
 
 /* Register log module */
 LOG_MODULE_REGISTER(transport, CONFIG_APP_TRANSPORT_LOG_LEVEL);
 
-
-BUILD_ASSERT(CONFIG_APP_TRANSPORT_WATCHDOG_TIMEOUT_SECONDS >
-			 CONFIG_APP_TRANSPORT_EXEC_TIME_SECONDS_MAX,
-			 "Watchdog timeout must be greater than maximum execution time");
-
 /* Register subscriber */
 ZBUS_MSG_SUBSCRIBER_DEFINE(transport);
 
 /* Observe channels */
-ZBUS_CHAN_ADD_OBS(PAYLOAD_CHAN, transport, 0);
-ZBUS_CHAN_ADD_OBS(NETWORK_CHAN, transport, 0);
+#define CHANNELS PAYLOAD_CHAN, NETWORK_CHAN, APP_CONFIG_CHAN
+
+CHAN_ADD_OBS(transport, CHANNELS);
 
-#define MAX_MSG_SIZE (MAX(sizeof(struct payload), sizeof(enum network_status)))
+#define MAX_MSG_SIZE CHAN_MSG_SIZE_MAX(CHANNELS)
 
 /* Enumerator to be used in privat transport channel */
 enum priv_transport_evt {
@@ -49,6 +45,10 @@ ZBUS_CHAN_DEFINE(PRIV_TRANSPORT_CHAN,
 		 IRRECOVERABLE_ERROR
 );
 
+#if defined(CONFIG_APP_MODULE_TRACE)
+ZBUS_CHAN_ADD_OBS(PRIV_TRANSPORT_CHAN, module_trace, 0);
+#endif
+
 /* Forward declarations */
 static const struct smf_state states[];
 
@@ -140,6 +140,11 @@ static struct s_object {
 
 	/* Network status */
 	enum network_status nw_status;
+
+	/* Delay between cloud connection attempts, can be changed by incoming CONFIG channel
+	 * messages
+	 */
+	uint32_t reconnection_timeout_sec;
 } s_obj;
 
 /* Define connection work - Used to handle reconnection attempts to the cloud */
@@ -153,14 +158,6 @@ static K_THREAD_STACK_DEFINE(stack_area, CONFIG_APP_TRANSPORT_WORKQUEUE_STACK_SI
  */
 static struct k_work_q transport_queue;
 
-static void task_wdt_callback(int channel_id, void *user_data)
-{
-	LOG_ERR("Watchdog expired, Channel: %d, Thread: %s",
-		channel_id, k_thread_name_get((k_tid_t)user_data));
-
-	SEND_FATAL_ERROR_WATCHDOG_TIMEOUT();
-}
-
 /* Connect work - Used to establish a connection to the clpoud and schedule reconnection attempts */
 static void connect_work_fn(struct k_work *work)
 {
@@ -170,6 +167,8 @@ static void connect_work_fn(struct k_work *work)
 	char buf[NRF_CLOUD_CLIENT_ID_MAX_LEN];
 	enum priv_transport_evt conn_result = CLOUD_CONN_SUCCES;
 
+	MODULE_TRACE_WORK_BEGIN();
+
 	err = nrf_cloud_client_id_get(buf, sizeof(buf));
 	if (!err) {
 		LOG_INF("Connecting to nRF Cloud CoAP with client ID: %s", buf);
@@ -177,7 +176,7 @@ static void connect_work_fn(struct k_work *work)
 		LOG_ERR("nrf_cloud_client_id_get, error: %d, cannot continue", err);
 
 		SEND_FATAL_ERROR();
-		return;
+		goto exit;
 	}
 
 	err = nrf_cloud_coap_connect(APP_VERSION_STRING);
@@ -190,12 +189,15 @@ static void connect_work_fn(struct k_work *work)
 	if (err) {
 		LOG_ERR("zbus_chan_pub, error: %d", err);
 		SEND_FATAL_ERROR();
-		return;
+		goto exit;
 	}
 
 retry:
 	k_work_reschedule_for_queue(&transport_queue, &connect_work,
-			  K_SECONDS(CONFIG_APP_TRANSPORT_RECONNECTION_TIMEOUT_SECONDS));
+				    K_SECONDS(s_obj.reconnection_timeout_sec));
+
+exit:
+	MODULE_TRACE_WORK_END();
 }
 
 static void connect_work_cancel(void)
@@ -211,10 +213,12 @@ static void state_running_entry(void *o)
 {
 	int err;
 
-	ARG_UNUSED(o);
+	struct s_object *state_object = o;
 
 	LOG_DBG("%s", __func__);
 
+	state_object->reconnection_timeout_sec = CONFIG_APP_TRANSPORT_RECONNECTION_TIMEOUT_SECONDS;
+
 	/* Initialize and start application workqueue.
 	 * This workqueue can be used to offload tasks and/or as a timer when wanting to
 	 * schedule functionality using the 'k_work' API.
@@ -222,7 +226,7 @@ static void state_running_entry(void *o)
 	k_work_queue_init(&transport_queue);
 	k_work_queue_start(&transport_queue, stack_area,
 			   K_THREAD_STACK_SIZEOF(stack_area),
-			   K_LOWEST_APPLICATION_THREAD_PRIO,
+			   CONFIG_APP_THREAD_PRIORITY_CRITICAL,
 			   NULL);
 	k_thread_name_set(&transport_queue.thread, "transport_workq");
 
@@ -250,6 +254,20 @@ static enum smf_state_result state_running_run(void *o)
 		}
 	}
 
+	if (state_object->chan == &APP_CONFIG_CHAN) {
+		const struct app_configuration *config =
+			MSG_TO_APP_CONFIGURATION(state_object->msg_buf);
+
+		if (config->reconnection_timeout_present) {
+			LOG_DBG("Reconnection timeout set to %d seconds",
+				config->reconnection_timeout);
+
+			state_object->reconnection_timeout_sec = config->reconnection_timeout;
+		}
+
+		return SMF_EVENT_HANDLED;
+	}
+
 	return SMF_EVENT_PROPAGATE;
 }
 
@@ -469,37 +487,33 @@ static enum smf_state_result state_connected_paused_run(void *o)
 static void transport_task(void)
 {
 	int err;
-	int task_wdt_id;
+	int supervisor_id;
 	const uint32_t wdt_timeout_ms = (CONFIG_APP_TRANSPORT_WATCHDOG_TIMEOUT_SECONDS * MSEC_PER_SEC);
-	const uint32_t execution_time_ms = (CONFIG_APP_TRANSPORT_EXEC_TIME_SECONDS_MAX * MSEC_PER_SEC);
-	const k_timeout_t zbus_wait_ms = K_MSEC(wdt_timeout_ms - execution_time_ms);
 
 	LOG_DBG("Transport module task started");
 
-	task_wdt_id = task_wdt_add(wdt_timeout_ms, task_wdt_callback, (void *)k_current_get());
+	supervisor_id = supervisor_add(&transport, wdt_timeout_ms);
+	if (supervisor_id < 0) {
+		LOG_ERR("supervisor_add, error: %d", supervisor_id);
+		SEND_FATAL_ERROR();
+
+		return;
+	}
 
 	/* Initialize the state machine to STATE_RUNNING, which will also run its entry function */
 	STATE_SET_INITIAL(STATE_RUNNING);
 
 	while (true) {
-		err = task_wdt_feed(task_wdt_id);
+		err = zbus_sub_wait_msg(&transport, &s_obj.chan, s_obj.msg_buf, K_FOREVER);
 		if (err) {
-			LOG_ERR("task_wdt_feed, error: %d", err);
-			SEND_FATAL_ERROR();
-
-			return;
-		}
-
-		err = zbus_sub_wait_msg(&transport, &s_obj.chan, s_obj.msg_buf, zbus_wait_ms);
-		if (err == -ENOMSG) {
-			continue;
-		} else if (err) {
 			LOG_ERR("zbus_sub_wait_msg, error: %d", err);
 			SEND_FATAL_ERROR();
 
 			return;
 		}
 
+		supervisor_checkin(supervisor_id);
+
 		err = STATE_RUN();
 		if (err) {
 			LOG_ERR("STATE_RUN(), error: %d", err);
@@ -507,9 +521,11 @@ static void transport_task(void)
 
 			return;
 		}
+
+		supervisor_checkout(supervisor_id);
 	}
 }
 
 K_THREAD_DEFINE(transport_task_id,
 		CONFIG_APP_TRANSPORT_THREAD_STACK_SIZE,
-		transport_task, NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+		transport_task, NULL, NULL, NULL, CONFIG_APP_THREAD_PRIORITY_CRITICAL, 0, 0);
@@ -11,6 +11,7 @@
 #include <zephyr/smf.h>
 
 #include "message_channel.h"
+#include "module_trace.h"
 
 /* Register log module */
 LOG_MODULE_REGISTER(trigger, CONFIG_APP_TRIGGER_LOG_LEVEL);
@@ -21,15 +22,15 @@ void trigger_callback(const struct zbus_channel *chan);
 ZBUS_LISTENER_DEFINE(trigger, trigger_callback);
 
 /* Observe channels */
-ZBUS_CHAN_ADD_OBS(CONFIG_CHAN, trigger, 0);
-ZBUS_CHAN_ADD_OBS(CLOUD_CHAN, trigger, 0);
-ZBUS_CHAN_ADD_OBS(BUTTON_CHAN, trigger, 0);
-ZBUS_CHAN_ADD_OBS(LOCATION_CHAN, trigger, 0);
-ZBUS_CHAN_ADD_OBS(FOTA_STATUS_CHAN, trigger, 0);
+/* Any configuration received from cloud is considered user activity, the LED configuration is
+ * observed for that purpose only.
+ */
+CHAN_ADD_OBS(trigger, APP_CONFIG_CHAN, LED_CONFIG_CHAN, CLOUD_CHAN, BUTTON_CHAN, LOCATION_CHAN,
+	     FOTA_STATUS_CHAN);
 
 /* Data sample trigger interval in the frequent poll state */
 #define FREQUENT_POLL_DATA_SAMPLE_TRIGGER_INTERVAL_SEC 60
-/* Shadow/fota poll trigger interval in the frequent poll state */
+/* Default shadow/fota poll trigger interval in the frequent poll state */
 #define FREQUENT_POLL_TRIGGER_INTERVAL_SEC 30
 
 /* Forward declarations */
@@ -94,6 +95,13 @@ struct s_object {
 	 */
 	uint64_t poll_interval_used_sec;
 
+	/* Duration of the frequent poll state and the shadow/fota poll trigger interval used in
+	 * that state. Defaults to build time values, can be changed by incoming CONFIG channel
+	 * messages.
+	 */
+	uint32_t frequent_poll_duration_sec;
+	uint32_t frequent_poll_interval_sec;
+
 	/* Location search status, used to block trigger events */
 	bool location_search;
 
@@ -149,17 +157,23 @@ static void trigger_work_fn(struct k_work *work)
 {
 	ARG_UNUSED(work);
 
+	MODULE_TRACE_WORK_BEGIN();
+
 	LOG_DBG("Sending data sample trigger");
 
 	trigger_send(TRIGGER_DATA_SAMPLE);
 
 	k_work_reschedule(&trigger_work, K_SECONDS(state_object.update_interval_used_sec));
+
+	MODULE_TRACE_WORK_END();
 }
 
 static void trigger_poll_work_fn(struct k_work *work)
 {
 	ARG_UNUSED(work);
 
+	MODULE_TRACE_WORK_BEGIN();
+
 	LOG_DBG("Sending shadow/fota poll trigger");
 
 	trigger_send(TRIGGER_POLL);
@@ -167,16 +181,18 @@ static void trigger_poll_work_fn(struct k_work *work)
 
 	k_work_reschedule(&trigger_poll_work,
 			  K_SECONDS(state_object.poll_interval_used_sec));
+
+	MODULE_TRACE_WORK_END();
 }
 
 static void frequent_poll_duration_timer_start(bool force_restart)
 {
 	if ((k_timer_remaining_get(&frequent_poll_duration_timer) == 0) || force_restart) {
 		LOG_DBG("Starting frequent poll duration timer: %d seconds",
-			CONFIG_FREQUENT_POLL_DURATION_INTERVAL_SEC);
+			state_object.frequent_poll_duration_sec);
 
 		k_timer_start(&frequent_poll_duration_timer,
-			      K_SECONDS(CONFIG_FREQUENT_POLL_DURATION_INTERVAL_SEC), K_NO_WAIT);
+			      K_SECONDS(state_object.frequent_poll_duration_sec), K_NO_WAIT);
 		return;
 	}
 }
@@ -186,6 +202,11 @@ static void frequent_poll_duration_timer_stop(void)
 	k_timer_stop(&frequent_poll_duration_timer);
 }
 
+static bool is_config_chan(const struct zbus_channel *chan)
+{
+	return (chan == &APP_CONFIG_CHAN) || (chan == &LED_CONFIG_CHAN);
+}
+
 /* Zephyr State Machine framework handlers */
 
 /* HSM states:
@@ -289,7 +310,7 @@ static enum smf_state_result blocked_run(void *o)
 		trigger_send(TRIGGER_POLL);
 		trigger_send(TRIGGER_FOTA_POLL);
 
-	} else if (user_object->chan == &CONFIG_CHAN) {
+	} else if (is_config_chan(user_object->chan)) {
 		LOG_DBG("Configuration received, refreshing poll duration timer");
 
 		frequent_poll_duration_timer_start(true);
@@ -311,7 +332,7 @@ static void frequent_poll_entry(void *o)
 	LOG_DBG("frequent_poll_entry");
 
 	user_object->update_interval_used_sec = FREQUENT_POLL_DATA_SAMPLE_TRIGGER_INTERVAL_SEC;
-	user_object->poll_interval_used_sec = FREQUENT_POLL_TRIGGER_INTERVAL_SEC;
+	user_object->poll_interval_used_sec = user_object->frequent_poll_interval_sec;
 	user_object->trigger_mode = TRIGGER_MODE_POLL;
 
 	if (user_object->chan == &LOCATION_CHAN && !user_object->location_search) {
@@ -332,11 +353,11 @@ static void frequent_poll_entry(void *o)
 
 	LOG_DBG("Sending data sample triggers every %d seconds for %d minutes",
 		FREQUENT_POLL_DATA_SAMPLE_TRIGGER_INTERVAL_SEC,
-		CONFIG_FREQUENT_POLL_DURATION_INTERVAL_SEC / 60);
+		user_object->frequent_poll_duration_sec / 60);
 
 	LOG_DBG("Sending shadow/fota poll triggers every %d seconds for %d minutes",
-		FREQUENT_POLL_TRIGGER_INTERVAL_SEC,
-		CONFIG_FREQUENT_POLL_DURATION_INTERVAL_SEC / 60);
+		user_object->frequent_poll_interval_sec,
+		user_object->frequent_poll_duration_sec / 60);
 
 	frequent_poll_duration_timer_start(false);
 	k_work_reschedule(&trigger_work, K_NO_WAIT);
@@ -366,9 +387,14 @@ static enum smf_state_result frequent_poll_run(void *o)
 		k_work_reschedule(&trigger_work, K_NO_WAIT);
 		k_work_reschedule(&trigger_poll_work, K_NO_WAIT);
 
-	} else if (user_object->chan == &CONFIG_CHAN) {
+	} else if (is_config_chan(user_object->chan)) {
 		LOG_DBG("Configuration received, refreshing poll duration timer");
 
+		/* The poll interval may have been changed by the configuration, it is used from
+		 * the next poll trigger.
+		 */
+		user_object->poll_interval_used_sec = user_object->frequent_poll_interval_sec;
+
 		frequent_poll_duration_timer_start(true);
 	} else {
 		/* Parent state may have handling of this event. */
@@ -437,7 +463,7 @@ static enum smf_state_result normal_run(void *o)
 
 		smf_set_state(SMF_CTX(&state_object), &states[STATE_FREQUENT_POLL]);
 		return SMF_EVENT_HANDLED;
-	} else if (user_object->chan == &CONFIG_CHAN) {
+	} else if (is_config_chan(user_object->chan)) {
 		LOG_DBG("Configuration received in normal state, going into frequent poll state");
 
 		smf_set_state(SMF_CTX(&state_object), &states[STATE_FREQUENT_POLL]);
@@ -454,7 +480,7 @@ static void normal_exit(void *o)
 	LOG_DBG("normal_exit");
 
 	user_object->update_interval_used_sec = FREQUENT_POLL_DATA_SAMPLE_TRIGGER_INTERVAL_SEC;
-	user_object->poll_interval_used_sec = FREQUENT_POLL_TRIGGER_INTERVAL_SEC;
+	user_object->poll_interval_used_sec = user_object->frequent_poll_interval_sec;
 
 	k_work_cancel_delayable(&trigger_work);
 	k_work_cancel_delayable(&trigger_poll_work);
@@ -580,52 +606,68 @@ void trigger_callback(const struct zbus_channel *chan)
 {
 	int err;
 
-	if ((chan != &CONFIG_CHAN) &&
-	    (chan != &CLOUD_CHAN) &&
-	    (chan != &LOCATION_CHAN) &&
-	    (chan != &BUTTON_CHAN) &&
-	    (chan != &FOTA_STATUS_CHAN) &&
-	    (chan != &PRIV_TRIGGER_CHAN)) {
-		LOG_ERR("Unknown channel");
-		return;
-	}
-
-	LOG_DBG("Received message on channel %s", zbus_chan_name(chan));
-
-	/* Update the state object with the channel that the message was received on */
-	state_object.chan = chan;
-
 	/* Copy corresponding data to the state object depending on the incoming channel */
-	if (&CONFIG_CHAN == chan) {
-		const struct configuration *config = zbus_chan_const_msg(chan);
+	switch (CHAN_ID(chan)) {
+	case CHAN_ID_APP_CONFIG_CHAN: {
+		const struct app_configuration *config = zbus_chan_const_msg(chan);
 
 		if (config->update_interval_present) {
 			state_object.update_interval_configured_sec = config->update_interval;
 		}
-	} else if (&CLOUD_CHAN == chan) {
+
+		if (config->frequent_poll_duration_present) {
+			state_object.frequent_poll_duration_sec = config->frequent_poll_duration;
+		}
+
+		if (config->frequent_poll_interval_present) {
+			state_object.frequent_poll_interval_sec = config->frequent_poll_interval;
+		}
+
+		break;
+	}
+	case CHAN_ID_CLOUD_CHAN: {
 		const enum cloud_status *status = zbus_chan_const_msg(chan);
 
 		state_object.status = *status;
-	} else if (&FOTA_STATUS_CHAN == chan) {
+		break;
+	}
+	case CHAN_ID_FOTA_STATUS_CHAN: {
 		const enum fota_status *fota_status = zbus_chan_const_msg(chan);
 
 		state_object.fota_status = *fota_status;
-	} else if (&BUTTON_CHAN == chan) {
+		break;
+	}
+	case CHAN_ID_BUTTON_CHAN: {
 		const int *button_number = zbus_chan_const_msg(chan);
 
 		state_object.button_number = (uint8_t)*button_number;
-	} else if (&LOCATION_CHAN == chan) {
+		break;
+	}
+	case CHAN_ID_LOCATION_CHAN: {
 		const enum location_status *location_status = zbus_chan_const_msg(chan);
 
 		state_object.location_search = (*location_status == LOCATION_SEARCH_STARTED);
 
 		LOG_DBG("Location search %s", state_object.location_search ? "started" : "done");
-	} else {
+		break;
+	}
+	default:
+		if (chan != &PRIV_TRIGGER_CHAN) {
+			LOG_ERR("Unknown channel");
+			return;
+		}
+
 		/* PRIV_TRIGGER_CHAN event. Frequent Poll Duration timer expired*/
 		LOG_DBG("Message received on PRIV_TRIGGER_CHAN channel.");
 		/* Do nothing to the state object */
+		break;
 	}
 
+	LOG_DBG("Received message on channel %s", zbus_chan_name(chan));
+
+	/* Update the state object with the channel that the message was received on */
+	state_object.chan = chan;
+
 	LOG_DBG("Running SMF");
 
 	/* State object updated, run SMF */
@@ -642,6 +684,8 @@ static int trigger_init(void)
 	state_object.update_interval_configured_sec = CONFIG_APP_TRIGGER_TIMEOUT_SECONDS;
 	state_object.update_interval_used_sec = CONFIG_APP_TRIGGER_TIMEOUT_SECONDS;
 	state_object.poll_interval_used_sec = FREQUENT_POLL_TRIGGER_INTERVAL_SEC;
+	state_object.frequent_poll_duration_sec = CONFIG_FREQUENT_POLL_DURATION_INTERVAL_SEC;
+	state_object.frequent_poll_interval_sec = FREQUENT_POLL_TRIGGER_INTERVAL_SEC;
 	state_object.trigger_mode = TRIGGER_MODE_POLL;
 
 	smf_set_initial(SMF_CTX(&state_object), &states[STATE_INIT]);
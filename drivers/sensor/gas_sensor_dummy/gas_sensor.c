@@ -7,6 +7,7 @@
 
 #include <zephyr/device.h>
 #include <zephyr/drivers/sensor.h>
+#include <zephyr/pm/device.h>
 
 #include "gas_sensor.h"
 #include "bme68x_iaq.h"
@@ -14,9 +15,23 @@
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(gas_sensor_dummy, CONFIG_SENSOR_LOG_LEVEL);
 
+#if defined(GAS_SENSOR_DUMMY_TRACE_BUILTIN)
+/* Generated from CONFIG_GAS_SENSOR_DUMMY_TRACE_FILE */
+#include "gas_sensor_trace.h"
+#endif /* GAS_SENSOR_DUMMY_TRACE_BUILTIN */
+
 static int gas_sensor_dummy_sample_fetch(const struct device *dev,
 				      enum sensor_channel chan)
 {
+#if defined(CONFIG_PM_DEVICE)
+	struct gas_sensor_dummy_data const *data = dev->data;
+
+	/* Like a real sensor, a suspended sensor does not measure */
+	if (data->suspended) {
+		return -EBUSY;
+	}
+#endif /* CONFIG_PM_DEVICE */
+
 	return 0;
 }
 
@@ -44,9 +59,7 @@ static int gas_sensor_dummy_channel_get(const struct device *dev,
 		val->val2 = 0;
 		break;
 	case SENSOR_CHAN_VOC:
-		val->val1 = data->voc;
-		val->val2 = 0;
-		break;
+		return sensor_value_from_float(val, data->voc);
 	default:
 		return -ENOTSUP;
 	}
@@ -54,21 +67,160 @@ static int gas_sensor_dummy_channel_get(const struct device *dev,
 	return 0;
 }
 
+static int gas_sensor_dummy_trigger_set(const struct device *dev,
+					const struct sensor_trigger *trig,
+					sensor_trigger_handler_t handler)
+{
+	struct gas_sensor_dummy_data *data = dev->data;
+
+	if (trig->type != SENSOR_TRIG_DATA_READY) {
+		return -ENOTSUP;
+	}
+
+	data->data_ready_handler = handler;
+	data->data_ready_trigger = trig;
+
+	return 0;
+}
+
+void gas_sensor_dummy_data_ready(const struct device *dev)
+{
+	struct gas_sensor_dummy_data const *data = dev->data;
+
+	if (data->data_ready_handler) {
+		data->data_ready_handler(dev, data->data_ready_trigger);
+	}
+}
+
+#if defined(CONFIG_GAS_SENSOR_DUMMY_TRACE)
+/* The trace restarts one step after its last step, where a step is the time between the last
+ * two steps.
+ */
+static uint32_t trace_period_ms(const struct gas_sensor_dummy_data *data)
+{
+	uint32_t last = data->trace[data->trace_len - 1].time_ms;
+	uint32_t previous = data->trace[data->trace_len - 2].time_ms;
+
+	return last + (last - previous);
+}
+
+static void trace_work_fn(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct gas_sensor_dummy_data *data = CONTAINER_OF(dwork, struct gas_sensor_dummy_data,
+							  trace_work);
+	const struct gas_sensor_dummy_sample *step = &data->trace[data->trace_index];
+	int64_t next_ms;
+
+	data->temperature = step->temperature;
+	data->pressure = step->pressure;
+	data->humidity = step->humidity;
+	data->iaq = step->iaq;
+	data->co2 = step->co2;
+	data->voc = step->voc;
+
+	LOG_DBG("Trace step %zu at %u ms", data->trace_index, step->time_ms);
+
+	gas_sensor_dummy_data_ready(data->dev);
+
+	data->trace_index++;
+
+	if (data->trace_index == data->trace_len) {
+		if (!IS_ENABLED(CONFIG_GAS_SENSOR_DUMMY_TRACE_LOOP) || (data->trace_len < 2)) {
+			LOG_DBG("Trace finished");
+			return;
+		}
+
+		data->trace_start_ms += trace_period_ms(data);
+		data->trace_index = 0;
+	}
+
+	/* Steps are scheduled from the start of the trace, so that the replay does not drift */
+	next_ms = data->trace_start_ms + data->trace[data->trace_index].time_ms;
+
+	k_work_reschedule(&data->trace_work, K_MSEC(MAX(next_ms - k_uptime_get(), 0)));
+}
+
+int gas_sensor_dummy_trace_set(const struct device *dev,
+			       const struct gas_sensor_dummy_sample *trace, size_t len)
+{
+	struct gas_sensor_dummy_data *data = dev->data;
+	struct k_work_sync sync;
+
+	for (size_t i = 1; i < len; i++) {
+		if (trace[i].time_ms <= trace[i - 1].time_ms) {
+			LOG_ERR("Trace step %zu is not after the previous step", i);
+			return -EINVAL;
+		}
+	}
+
+	(void)k_work_cancel_delayable_sync(&data->trace_work, &sync);
+
+	data->trace = trace;
+	data->trace_len = len;
+	data->trace_index = 0;
+	data->trace_start_ms = k_uptime_get();
+
+	if (len == 0) {
+		return 0;
+	}
+
+	k_work_reschedule(&data->trace_work, K_MSEC(trace[0].time_ms));
+
+	return 0;
+}
+#endif /* CONFIG_GAS_SENSOR_DUMMY_TRACE */
+
 static const struct sensor_driver_api gas_sensor_dummy_api = {
 	.sample_fetch = &gas_sensor_dummy_sample_fetch,
 	.channel_get = &gas_sensor_dummy_channel_get,
+	.trigger_set = &gas_sensor_dummy_trigger_set,
 };
 
+#if defined(CONFIG_PM_DEVICE)
+static int gas_sensor_dummy_pm_action(const struct device *dev, enum pm_device_action action)
+{
+	struct gas_sensor_dummy_data *data = dev->data;
+
+	switch (action) {
+	case PM_DEVICE_ACTION_SUSPEND:
+		data->suspended = true;
+		break;
+	case PM_DEVICE_ACTION_RESUME:
+		data->suspended = false;
+		break;
+	default:
+		return -ENOTSUP;
+	}
+
+	return 0;
+}
+#endif /* CONFIG_PM_DEVICE */
+
 static int gas_sensor_dummy_init(const struct device *dev)
 {
+#if defined(CONFIG_GAS_SENSOR_DUMMY_TRACE)
+	struct gas_sensor_dummy_data *data = dev->data;
+
+	data->dev = dev;
+	k_work_init_delayable(&data->trace_work, trace_work_fn);
+
+#if defined(GAS_SENSOR_DUMMY_TRACE_BUILTIN)
+	return gas_sensor_dummy_trace_set(dev, gas_sensor_dummy_trace,
+					  ARRAY_SIZE(gas_sensor_dummy_trace));
+#endif /* GAS_SENSOR_DUMMY_TRACE_BUILTIN */
+#endif /* CONFIG_GAS_SENSOR_DUMMY_TRACE */
+
 	return 0;
 }
 
 #define EXAMPLE_SENSOR_INIT(i)						       \
 	static struct gas_sensor_dummy_data gas_sensor_dummy_data_##i;	       \
 									       \
+	PM_DEVICE_DT_INST_DEFINE(i, gas_sensor_dummy_pm_action);	       \
 									       \
-	DEVICE_DT_INST_DEFINE(i, gas_sensor_dummy_init, NULL,		       \
+	DEVICE_DT_INST_DEFINE(i, gas_sensor_dummy_init,			       \
+			      PM_DEVICE_DT_INST_GET(i),			       \
 			      &gas_sensor_dummy_data_##i,			       \
 			      NULL, POST_KERNEL,	       \
 			      CONFIG_SENSOR_INIT_PRIORITY, &gas_sensor_dummy_api);
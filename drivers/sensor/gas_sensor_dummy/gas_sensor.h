@@ -6,11 +6,56 @@
 #include <zephyr/device.h>
 #include <zephyr/drivers/sensor.h>
 
+/* One step of a trace, the values are reported from the time of the step until the next */
+struct gas_sensor_dummy_sample {
+	/* Time of the step from the start of the trace, in milliseconds */
+	uint32_t time_ms;
+	float temperature;
+	float pressure;
+	float humidity;
+	int iaq;
+	int co2;
+	float voc;
+};
+
 struct gas_sensor_dummy_data {
 	float temperature;
 	float pressure;
 	float humidity;
 	int iaq;
 	int co2;
-	int voc;
+	float voc;
+
+	/* Data ready trigger, set through sensor_trigger_set() */
+	sensor_trigger_handler_t data_ready_handler;
+	const struct sensor_trigger *data_ready_trigger;
+
+#if defined(CONFIG_PM_DEVICE)
+	/* Set while the device is suspended, samples cannot be fetched */
+	bool suspended;
+#endif /* CONFIG_PM_DEVICE */
+
+#if defined(CONFIG_GAS_SENSOR_DUMMY_TRACE)
+	/* Trace being replayed, and the uptime of the start of its current pass */
+	const struct gas_sensor_dummy_sample *trace;
+	size_t trace_len;
+	size_t trace_index;
+	int64_t trace_start_ms;
+	struct k_work_delayable trace_work;
+	const struct device *dev;
+#endif /* CONFIG_GAS_SENSOR_DUMMY_TRACE */
 };
+
+/* Call the data ready trigger handler, if set, like the BME68X IAQ driver does when it has
+ * new results.
+ */
+void gas_sensor_dummy_data_ready(const struct device *dev);
+
+/* Replay a trace, starting now. The values of each step are applied at its time relative to
+ * the start, and the data ready trigger handler is called. The trace must stay valid while it
+ * is replayed. A trace of length 0 stops the replay, the values of the last step are kept.
+ *
+ * Returns 0 on success, or -EINVAL if the steps are not in increasing order of time.
+ */
+int gas_sensor_dummy_trace_set(const struct device *dev,
+			       const struct gas_sensor_dummy_sample *trace, size_t len);
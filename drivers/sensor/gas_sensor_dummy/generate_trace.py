@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Convert a CSV trace of the gas sensor values to a table replayed by the dummy driver.
+
+The first line of the trace is the header with the columns below, in any order. Each following
+line is a step of the trace, the time of the steps is in milliseconds from the start of the
+trace and must increase.
+"""
+
+import argparse
+import csv
+import sys
+
+FLOAT_COLUMNS = ["temperature", "pressure", "humidity", "voc"]
+INT_COLUMNS = ["time_ms", "iaq", "co2"]
+COLUMNS = ["time_ms", "temperature", "pressure", "humidity", "iaq", "co2", "voc"]
+
+
+def steps_read(path):
+    steps = []
+
+    with open(path, newline="", encoding="utf-8") as f:
+        reader = csv.DictReader(f)
+
+        missing = set(COLUMNS) - set(reader.fieldnames or [])
+        if missing:
+            sys.exit(f"{path}: missing columns: {', '.join(sorted(missing))}")
+
+        for row in reader:
+            step = {name: int(row[name]) for name in INT_COLUMNS}
+            step.update({name: float(row[name]) for name in FLOAT_COLUMNS})
+
+            if steps and step["time_ms"] <= steps[-1]["time_ms"]:
+                sys.exit(f"{path}:{reader.line_num}: time_ms does not increase")
+
+            steps.append(step)
+
+    if not steps:
+        sys.exit(f"{path}: no steps")
+
+    return steps
+
+
+def header(path, steps):
+    out = [f"/* Generated by generate_trace.py from {path}, do not edit */", "",
+           "static const struct gas_sensor_dummy_sample gas_sensor_dummy_trace[] = {"]
+
+    for step in steps:
+        out.append(f"\t{{ .time_ms = {step['time_ms']}, .temperature = {step['temperature']}f, "
+                   f".pressure = {step['pressure']}f, .humidity = {step['humidity']}f, "
+                   f".iaq = {step['iaq']}, .co2 = {step['co2']}, .voc = {step['voc']}f }},")
+
+    out.append("};")
+    out.append("")
+
+    return "\n".join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert a gas sensor trace to a C table")
+    parser.add_argument("-i", "--input", required=True, help="CSV trace")
+    parser.add_argument("-o", "--output", required=True, help="output C header")
+    args = parser.parse_args()
+
+    steps = steps_read(args.input)
+
+    with open(args.output, "w", encoding="utf-8") as f:
+        f.write(header(args.input, steps))
+
+
+if __name__ == "__main__":
+    main()
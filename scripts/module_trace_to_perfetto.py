@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+
+"""Convert a module trace dump to a Chrome trace event file.
+
+The input is the output of the "trace dump" shell command, for example a captured UART log or the
+shell output of a native_sim run. Lines that do not contain trace records
+are ignored. The output can be opened in https://ui.perfetto.dev or chrome://tracing.
+
+Each module thread gets its own track. State machine states are shown as slices, channel
+publishing and reception as short slices, and flow arrows connect a publish to the reception
+of the same message in the subscribing threads.
+"""
+
+import argparse
+import json
+import re
+import sys
+
+RECORD_PATTERN = re.compile(r"trace,(\d+),(\w+),([^,]*),([^,]*),(\d+)")
+
+PID = 1
+
+# Duration in microseconds of the slices used for instantaneous events
+INSTANT_DURATION_US = 1
+
+
+def parse(lines):
+    records = []
+
+    for line in lines:
+        match = RECORD_PATTERN.search(line)
+        if not match:
+            continue
+
+        timestamp, event, thread, ref, arg = match.groups()
+        records.append({
+            "ts": int(timestamp),
+            "event": event,
+            "thread": thread,
+            "ref": ref,
+            "arg": int(arg),
+        })
+
+    return records
+
+
+def convert(records):
+    events = []
+    tids = {}
+    open_states = {}
+    last_pub = {}
+    flow_id = 0
+
+    def tid_get(thread):
+        if thread not in tids:
+            tids[thread] = len(tids) + 1
+            events.append({
+                "name": "thread_name", "ph": "M", "pid": PID, "tid": tids[thread],
+                "args": {"name": thread},
+            })
+
+        return tids[thread]
+
+    for record in records:
+        tid = tid_get(record["thread"])
+        ts = record["ts"]
+        event = record["event"]
+
+        if event == "state_entry":
+            open_states[tid] = record["arg"]
+            events.append({
+                "name": f"state {record['arg']}", "cat": "state", "ph": "B",
+                "pid": PID, "tid": tid, "ts": ts,
+            })
+        elif event == "state_exit":
+            if open_states.pop(tid, None) is not None:
+                events.append({"ph": "E", "pid": PID, "tid": tid, "ts": ts})
+        elif event == "chan_pub":
+            last_pub[record["ref"]] = (ts, tid)
+            events.append({
+                "name": f"pub {record['ref']}", "cat": "zbus", "ph": "X",
+                "pid": PID, "tid": tid, "ts": ts, "dur": INSTANT_DURATION_US,
+            })
+        elif event == "chan_recv":
+            events.append({
+                "name": f"recv {record['ref']}", "cat": "zbus", "ph": "X",
+                "pid": PID, "tid": tid, "ts": ts, "dur": INSTANT_DURATION_US,
+            })
+
+            if record["ref"] in last_pub:
+                pub_ts, pub_tid = last_pub[record["ref"]]
+                flow_id += 1
+                events.append({
+                    "name": record["ref"], "cat": "zbus", "ph": "s", "id": flow_id,
+                    "pid": PID, "tid": pub_tid, "ts": pub_ts,
+                })
+                events.append({
+                    "name": record["ref"], "cat": "zbus", "ph": "f", "bp": "e",
+                    "id": flow_id, "pid": PID, "tid": tid, "ts": ts,
+                })
+        elif event == "work_begin":
+            events.append({
+                "name": record["ref"], "cat": "work", "ph": "B",
+                "pid": PID, "tid": tid, "ts": ts,
+            })
+        elif event == "work_end":
+            events.append({"ph": "E", "pid": PID, "tid": tid, "ts": ts})
+
+    # Close states that are still active at the end of the trace
+    if records:
+        end = records[-1]["ts"]
+        for tid in open_states:
+            events.append({"ph": "E", "pid": PID, "tid": tid, "ts": end})
+
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert a module trace dump to a Chrome trace")
+    parser.add_argument("input", nargs="?", help="trace dump, stdin is used if not given")
+    parser.add_argument("-o", "--output", help="output JSON file, stdout is used if not given")
+    args = parser.parse_args()
+
+    if args.input:
+        with open(args.input, encoding="utf-8", errors="replace") as f:
+            records = parse(f)
+    else:
+        records = parse(sys.stdin)
+
+    trace = convert(records)
+
+    if args.output:
+        with open(args.output, "w", encoding="utf-8") as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+
+    print(f"Converted {len(records)} records", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
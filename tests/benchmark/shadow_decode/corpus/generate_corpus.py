@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+
+"""Generate the shadow corpus used by the shadow decode benchmark.
+
+The corpus consists of the shadows stored as JSON in this directory, encoded to CBOR the same
+way nRF Cloud encodes them, and of generated shadows that stress the decoder: large pairing
+sections, many LwM2M objects that are not used by the application, and malformed documents.
+
+The JSON shadows are synthetic, written by hand after the structure of the shadows that nRF
+Cloud sends, and are not recorded from a device. Their names start with "synthetic_".
+
+The output is a C header with one array per document and a table with the expected result of
+shadow_decode() for each of them.
+"""
+
+import argparse
+import glob
+import json
+import os
+
+import cbor2
+
+LED_KEY = "14240:1.0"
+CONFIG_KEY = "14301:1.0"
+
+# Sizes of the generated documents, the default shadow receive buffer is 1024 bytes
+DOCUMENT_SIZES = [256, 512, 1024, 2048, 4096]
+
+# Number of LwM2M objects not used by the application in the generated documents
+UNKNOWN_OBJECT_COUNTS = [1, 4, 16, 64]
+
+LED = {"0": {"0": 255, "1": 0, "2": 0, "99": 1717000000}}
+CONFIG = {"0": {"0": 600, "1": True, "99": 1717000000}}
+
+
+def entry(name, data, err="0", led=False, config=False):
+    return {"name": name, "data": data, "err": err, "led": led, "config": config}
+
+
+def shadow_entry(name, shadow):
+    lwm2m = shadow.get("lwm2m", {})
+
+    return entry(name, cbor2.dumps(shadow), led=LED_KEY in lwm2m, config=CONFIG_KEY in lwm2m)
+
+
+def stored_shadows(directory):
+    entries = []
+
+    for path in sorted(glob.glob(os.path.join(directory, "*.json"))):
+        with open(path, encoding="utf-8") as f:
+            shadow = json.load(f)
+
+        entries.append(shadow_entry(os.path.splitext(os.path.basename(path))[0], shadow))
+
+    return entries
+
+
+def pairing_shadows():
+    """Shadows where the pairing section dominates the size of the document."""
+    entries = []
+
+    for size in DOCUMENT_SIZES:
+        topics = {"d2c": "prod/tenant/m/d/device/d2c", "c2d": "prod/tenant/m/d/device/+/r"}
+        shadow = {
+            "pairing": {"state": "paired", "topics": topics},
+            "lwm2m": {LED_KEY: LED, CONFIG_KEY: CONFIG},
+        }
+
+        index = 0
+        while len(cbor2.dumps(shadow)) < size:
+            topics[f"topic{index}"] = f"prod/tenant/m/d/device/topic{index}"
+            index += 1
+
+        entries.append(shadow_entry(f"pairing_{size}", shadow))
+
+    return entries
+
+
+def unknown_object_shadows():
+    """Shadows with LwM2M objects that are not used by the application."""
+    entries = []
+
+    for count in UNKNOWN_OBJECT_COUNTS:
+        lwm2m = {}
+
+        for index in range(count):
+            lwm2m[f"{14400 + index}:1.0"] = {"0": {"0": 21.5, "1": index, "99": 1717000000}}
+
+        lwm2m[LED_KEY] = LED
+        lwm2m[CONFIG_KEY] = CONFIG
+
+        entries.append(shadow_entry(f"unknown_objects_{count}", {"lwm2m": lwm2m}))
+
+    return entries
+
+
+def malformed_shadows():
+    """Documents that must be rejected, or where entries must be skipped."""
+    valid = cbor2.dumps({"lwm2m": {LED_KEY: LED, CONFIG_KEY: CONFIG}})
+
+    return [
+        entry("empty_map", cbor2.dumps({})),
+        entry("not_a_map", cbor2.dumps([1, 2, 3]), err="-EBADMSG"),
+        entry("truncated", valid[:-1], err="-EBADMSG"),
+        entry("truncated_half", valid[:len(valid) // 2], err="-EBADMSG"),
+        entry("led_wrong_type", cbor2.dumps({"lwm2m": {LED_KEY: "off"}}), err="-EBADMSG"),
+        entry("config_missing_timestamp",
+              cbor2.dumps({"lwm2m": {CONFIG_KEY: {"0": {"0": 600}}}}), err="-EBADMSG"),
+        entry("integer_keys", cbor2.dumps({1: [1, 2], "lwm2m": {2: 3, LED_KEY: LED}}), led=True),
+        entry("deep_unknown_value",
+              cbor2.dumps({"unknown": [[[[[[[[{"a": [1]}]]]]]]]], "lwm2m": {CONFIG_KEY: CONFIG}}),
+              config=True),
+    ]
+
+
+def c_array(data):
+    lines = []
+
+    for i in range(0, len(data), 12):
+        lines.append("\t" + ", ".join(f"0x{b:02x}" for b in data[i:i + 12]) + ",")
+
+    return "\n".join(lines)
+
+
+def header(entries):
+    out = ["/* Generated by generate_corpus.py, do not edit */", "",
+           "#include \"corpus.h\"", ""]
+
+    for index, e in enumerate(entries):
+        out.append(f"static const uint8_t corpus_{index}[] = {{")
+        out.append(c_array(e["data"]))
+        out.append("};")
+        out.append("")
+
+    out.append("static const struct corpus_entry corpus[] = {")
+
+    for index, e in enumerate(entries):
+        out.append("\t{")
+        out.append(f"\t\t.name = \"{e['name']}\",")
+        out.append(f"\t\t.data = corpus_{index},")
+        out.append(f"\t\t.len = sizeof(corpus_{index}),")
+        out.append(f"\t\t.expected_err = {e['err']},")
+        out.append(f"\t\t.led_present = {'true' if e['led'] else 'false'},")
+        out.append(f"\t\t.config_present = {'true' if e['config'] else 'false'},")
+        out.append("\t},")
+
+    out.append("};")
+    out.append("")
+
+    return "\n".join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate the shadow decode benchmark corpus")
+    parser.add_argument("-o", "--output", required=True, help="output C header")
+    args = parser.parse_args()
+
+    directory = os.path.dirname(os.path.abspath(__file__))
+    entries = (stored_shadows(directory) + pairing_shadows() + unknown_object_shadows() +
+               malformed_shadows())
+
+    with open(args.output, "w", encoding="utf-8") as f:
+        f.write(header(entries))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _CORPUS_H_
+#define _CORPUS_H_
+
+#include <zephyr/kernel.h>
+
+/** @brief A shadow document in the benchmark corpus, and the expected result of decoding it. */
+struct corpus_entry {
+	const char *name;
+	const uint8_t *data;
+	size_t len;
+
+	/* Expected return value of shadow_decode() */
+	int expected_err;
+
+	/* Objects that shadow_decode() is expected to extract */
+	bool led_present;
+	bool config_present;
+};
+
+#endif /* _CORPUS_H_ */
@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Built in the context of the native simulator runner, which has access to the host C library.
+ * Time does not advance on native_sim while the decoder runs, so the host clock is used to
+ * measure it instead.
+ */
+#include <stdint.h>
+#include <time.h>
+
+/* CPU time consumed by the calling host thread, in nanoseconds */
+uint64_t bench_host_time_ns(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
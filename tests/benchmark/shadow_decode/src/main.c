@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <unity.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "shadow_decode.h"
+#include "corpus_data.h"
+
+/* shadow_decode.c logs to the log module of the app module */
+LOG_MODULE_REGISTER(app, CONFIG_APP_LOG_LEVEL);
+
+/* Decodes of each document per measurement, the reported time is the average */
+#define BENCH_ITERATIONS 100
+
+#define BENCH_STACK_SIZE 4096
+
+/* Stack that shadow_decode() may use on target, leaving room in the shadow workqueue stack
+ * for the CoAP request and logging.
+ */
+#define SHADOW_DECODE_STACK_MAX 1536
+
+enum decoder {
+	/* shadow_decode(), used by the app module */
+	DECODER_SHADOW,
+	/* Decoder generated for the whole app-object type in app_object.cddl */
+	DECODER_APP_OBJECT,
+};
+
+struct bench_result {
+	int err;
+	uint64_t time_ns;
+	uint32_t cycles;
+	size_t stack_used;
+};
+
+#if defined(CONFIG_BOARD_NATIVE_SIM)
+/* Implemented in host_clock.c */
+extern uint64_t bench_host_time_ns(void);
+#endif /* CONFIG_BOARD_NATIVE_SIM */
+
+static K_THREAD_STACK_DEFINE(bench_stack, BENCH_STACK_SIZE);
+static struct k_thread bench_thread;
+
+static int decode(enum decoder decoder, const struct corpus_entry *entry)
+{
+	if (decoder == DECODER_SHADOW) {
+		struct shadow_objects objects;
+
+		return shadow_decode(entry->data, entry->len, &objects);
+	}
+
+	struct app_object app_object;
+	size_t not_used;
+
+	return cbor_decode_app_object(entry->data, entry->len, &app_object, &not_used) ?
+	       -EBADMSG : 0;
+}
+
+static void bench_fn(void *p1, void *p2, void *p3)
+{
+	const struct corpus_entry *entry = p1;
+	enum decoder decoder = POINTER_TO_INT(p2);
+	struct bench_result *result = p3;
+
+#if defined(CONFIG_BOARD_NATIVE_SIM)
+	/* Time does not advance on native_sim while the decoder runs, the CPU time of the
+	 * host thread that runs this thread is measured instead.
+	 */
+	uint64_t start = bench_host_time_ns();
+
+	for (int i = 0; i < BENCH_ITERATIONS; i++) {
+		result->err = decode(decoder, entry);
+	}
+
+	result->time_ns = (bench_host_time_ns() - start) / BENCH_ITERATIONS;
+#else
+	uint32_t start = k_cycle_get_32();
+	uint32_t cycles;
+
+	for (int i = 0; i < BENCH_ITERATIONS; i++) {
+		result->err = decode(decoder, entry);
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	result->cycles = cycles / BENCH_ITERATIONS;
+	result->time_ns = k_cyc_to_ns_floor64(cycles) / BENCH_ITERATIONS;
+#endif /* CONFIG_BOARD_NATIVE_SIM */
+}
+
+/* Decode the document in a thread of its own, so that the stack high-water mark of the
+ * decoder can be measured.
+ */
+static void bench_run(enum decoder decoder, const struct corpus_entry *entry,
+		      struct bench_result *result)
+{
+	int err;
+	size_t unused;
+
+	k_thread_create(&bench_thread, bench_stack, K_THREAD_STACK_SIZEOF(bench_stack),
+			bench_fn, (void *)entry, INT_TO_POINTER(decoder), result,
+			K_PRIO_PREEMPT(0), 0, K_NO_WAIT);
+
+	err = k_thread_join(&bench_thread, K_FOREVER);
+	TEST_ASSERT_EQUAL(0, err);
+
+	err = k_thread_stack_space_get(&bench_thread, &unused);
+	TEST_ASSERT_EQUAL(0, err);
+
+	result->stack_used = K_THREAD_STACK_SIZEOF(bench_stack) - unused;
+}
+
+void test_shadow_decode_corpus(void)
+{
+	int err;
+	struct shadow_objects objects;
+
+	for (size_t i = 0; i < ARRAY_SIZE(corpus); i++) {
+		const struct corpus_entry *entry = &corpus[i];
+
+		LOG_DBG("Decoding %s, %zu bytes", entry->name, entry->len);
+
+		err = shadow_decode(entry->data, entry->len, &objects);
+		TEST_ASSERT_EQUAL_MESSAGE(entry->expected_err, err, entry->name);
+
+		if (err) {
+			continue;
+		}
+
+		TEST_ASSERT_EQUAL_MESSAGE(entry->led_present, objects.led_present, entry->name);
+		TEST_ASSERT_EQUAL_MESSAGE(entry->config_present, objects.config_present,
+					  entry->name);
+	}
+}
+
+/* Prints one line per document and decoder:
+ * bench,<document>,<size>,<decoder>,<result>,<ns per decode>,<cycles per decode>,<stack bytes>
+ *
+ * On native_sim, the time is the CPU time of the host, and cycles and stack usage are not
+ * available as threads run on host stacks. They are printed as "-".
+ */
+void test_shadow_decode_benchmark(void)
+{
+	static const char * const decoder_names[] = {
+		[DECODER_SHADOW] = "shadow_decode",
+		[DECODER_APP_OBJECT] = "app_object",
+	};
+	struct bench_result result;
+
+	for (size_t i = 0; i < ARRAY_SIZE(corpus); i++) {
+		const struct corpus_entry *entry = &corpus[i];
+
+		for (int decoder = 0; decoder < ARRAY_SIZE(decoder_names); decoder++) {
+			memset(&result, 0, sizeof(result));
+
+			bench_run(decoder, entry, &result);
+
+			if (IS_ENABLED(CONFIG_BOARD_NATIVE_SIM)) {
+				printk("bench,%s,%zu,%s,%d,%llu,-,-\n", entry->name, entry->len,
+				       decoder_names[decoder], result.err,
+				       (unsigned long long)result.time_ns);
+
+				TEST_ASSERT_TRUE_MESSAGE(result.time_ns > 0, entry->name);
+			} else {
+				printk("bench,%s,%zu,%s,%d,%llu,%u,%zu\n", entry->name,
+				       entry->len, decoder_names[decoder], result.err,
+				       (unsigned long long)result.time_ns, result.cycles,
+				       result.stack_used);
+			}
+
+			if (decoder != DECODER_SHADOW) {
+				continue;
+			}
+
+			TEST_ASSERT_EQUAL_MESSAGE(entry->expected_err, result.err, entry->name);
+
+			if (!IS_ENABLED(CONFIG_ARCH_POSIX)) {
+				TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(SHADOW_DECODE_STACK_MAX,
+								  result.stack_used, entry->name);
+			}
+		}
+	}
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
@@ -0,0 +1,904 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <unity.h>
+
+#include <zephyr/fff.h>
+#include <zephyr/init.h>
+#include <zephyr/zbus/zbus.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+
+#include "message_channel.h"
+#include "supervisor.h"
+#include "shadow_decode.h"
+#include "config_stored.h"
+
+DEFINE_FFF_GLOBALS;
+
+FAKE_VALUE_FUNC(int, supervisor_add, const struct zbus_observer *, uint32_t);
+FAKE_VALUE_FUNC(int, supervisor_add_work_queue, struct k_work_q *, uint32_t);
+FAKE_VOID_FUNC(supervisor_checkin, int);
+FAKE_VOID_FUNC(supervisor_checkout, int);
+FAKE_VOID_FUNC(date_time_register_handler, void *);
+FAKE_VALUE_FUNC(int, nrf_cloud_coap_shadow_get, char *, size_t *, bool, int);
+FAKE_VALUE_FUNC(int, nrf_cloud_coap_patch, const char *, const char *, const uint8_t *, size_t,
+		int, bool, void *, void *);
+
+LOG_MODULE_REGISTER(app_module_test, 4);
+
+ZBUS_MSG_SUBSCRIBER_DEFINE(test_subscriber);
+ZBUS_CHAN_ADD_OBS(LED_CONFIG_CHAN, test_subscriber, 0);
+ZBUS_CHAN_ADD_OBS(APP_CONFIG_CHAN, test_subscriber, 0);
+ZBUS_CHAN_ADD_OBS(ENV_CONFIG_CHAN, test_subscriber, 0);
+
+/* Objects published by the app module in response to a shadow request */
+struct published_config {
+	bool led_present;
+	struct led_configuration led;
+	bool app_present;
+	struct app_configuration app;
+	bool env_present;
+	struct env_configuration env;
+};
+
+/* Interval at which the trigger module sends poll triggers in the frequent poll state */
+#define POLL_TRIGGER_INTERVAL_SEC 30
+#define POLL_TRIGGERS_PER_HOUR (3600 / POLL_TRIGGER_INTERVAL_SEC)
+
+/* With a 30 second minimum and a 300 second maximum poll interval, an hour of poll triggers
+ * without shadow changes results in polls at 30, 90, 210 and 450 seconds and then every
+ * 300 seconds.
+ */
+#define SHADOW_POLLS_PER_HOUR_MAX 15
+
+/* {"lwm2m": {"14301:1.0": {"0": {"0": 120, "99": 1717000000}}}} */
+static const uint8_t shadow_delta[] = {
+	0xa1, 0x65, 0x6c, 0x77, 0x6d, 0x32, 0x6d, 0xa1, 0x69, 0x31, 0x34, 0x33,
+	0x30, 0x31, 0x3a, 0x31, 0x2e, 0x30, 0xa1, 0x61, 0x30, 0xa2, 0x61, 0x30,
+	0x18, 0x78, 0x62, 0x39, 0x39, 0x1a, 0x66, 0x57, 0x57, 0x40
+};
+
+/* {"lwm2m": {"14240:1.0": {"0": {"0": 255, "1": 0, "2": 0, "99": 1717000100}},
+ *            "14301:1.0": {"0": {"0": 120, "99": 1717000000}}}}
+ */
+static const uint8_t shadow_delta_led_changed[] = {
+	0xa1, 0x65, 0x6c, 0x77, 0x6d, 0x32, 0x6d, 0xa2, 0x69, 0x31, 0x34, 0x32,
+	0x34, 0x30, 0x3a, 0x31, 0x2e, 0x30, 0xa1, 0x61, 0x30, 0xa4, 0x61, 0x30,
+	0x18, 0xff, 0x61, 0x31, 0x00, 0x61, 0x32, 0x00, 0x62, 0x39, 0x39, 0x1a,
+	0x66, 0x57, 0x57, 0xa4, 0x69, 0x31, 0x34, 0x33, 0x30, 0x31, 0x3a, 0x31,
+	0x2e, 0x30, 0xa1, 0x61, 0x30, 0xa2, 0x61, 0x30, 0x18, 0x78, 0x62, 0x39,
+	0x39, 0x1a, 0x66, 0x57, 0x57, 0x40
+};
+
+/* {"pairing": {"state": "paired", "topics": {"d2c": "a/d2c", "c2d": "a/c2d"}},
+ *  "nrfcloud_mqtt_topic_prefix": "prod/a/", 1: [1, 2, 3],
+ *  "lwm2m": {"14203:1.0": {"0": {"0": 1.5}},
+ *            "14240:1.0": {"0": {"0": 1, "1": 2, "2": 3, "99": 5}}},
+ *  "unknown": {"nested": [{"a": 1}]}}
+ */
+static const uint8_t shadow_unknown_entries[] = {
+	0xa5, 0x67, 0x70, 0x61, 0x69, 0x72, 0x69, 0x6e, 0x67, 0xa2, 0x65, 0x73,
+	0x74, 0x61, 0x74, 0x65, 0x66, 0x70, 0x61, 0x69, 0x72, 0x65, 0x64, 0x66,
+	0x74, 0x6f, 0x70, 0x69, 0x63, 0x73, 0xa2, 0x63, 0x64, 0x32, 0x63, 0x65,
+	0x61, 0x2f, 0x64, 0x32, 0x63, 0x63, 0x63, 0x32, 0x64, 0x65, 0x61, 0x2f,
+	0x63, 0x32, 0x64, 0x78, 0x1a, 0x6e, 0x72, 0x66, 0x63, 0x6c, 0x6f, 0x75,
+	0x64, 0x5f, 0x6d, 0x71, 0x74, 0x74, 0x5f, 0x74, 0x6f, 0x70, 0x69, 0x63,
+	0x5f, 0x70, 0x72, 0x65, 0x66, 0x69, 0x78, 0x67, 0x70, 0x72, 0x6f, 0x64,
+	0x2f, 0x61, 0x2f, 0x01, 0x83, 0x01, 0x02, 0x03, 0x65, 0x6c, 0x77, 0x6d,
+	0x32, 0x6d, 0xa2, 0x69, 0x31, 0x34, 0x32, 0x30, 0x33, 0x3a, 0x31, 0x2e,
+	0x30, 0xa1, 0x61, 0x30, 0xa1, 0x61, 0x30, 0xfb, 0x3f, 0xf8, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x69, 0x31, 0x34, 0x32, 0x34, 0x30, 0x3a, 0x31,
+	0x2e, 0x30, 0xa1, 0x61, 0x30, 0xa4, 0x61, 0x30, 0x01, 0x61, 0x31, 0x02,
+	0x61, 0x32, 0x03, 0x62, 0x39, 0x39, 0x05, 0x67, 0x75, 0x6e, 0x6b, 0x6e,
+	0x6f, 0x77, 0x6e, 0xa1, 0x66, 0x6e, 0x65, 0x73, 0x74, 0x65, 0x64, 0x81,
+	0xa1, 0x61, 0x61, 0x01
+};
+
+/* {"lwm2m": {"14301:1.0": {"0": {"0": 240, "99": 1717000200}}}} */
+static const uint8_t shadow_delta_config_changed[] = {
+	0xa1, 0x65, 0x6c, 0x77, 0x6d, 0x32, 0x6d, 0xa1, 0x69, 0x31, 0x34, 0x33,
+	0x30, 0x31, 0x3a, 0x31, 0x2e, 0x30, 0xa1, 0x61, 0x30, 0xa2, 0x61, 0x30,
+	0x18, 0xf0, 0x62, 0x39, 0x39, 0x1a, 0x66, 0x57, 0x58, 0x08
+};
+
+/* {"lwm2m": {"14301:1.0": {"0": {"2": 300, "3": 60, "4": 120, "5": 90, "99": 1717000300}}}} */
+static const uint8_t shadow_delta_policy[] = {
+	0xa1, 0x65, 0x6c, 0x77, 0x6d, 0x32, 0x6d, 0xa1, 0x69, 0x31, 0x34, 0x33,
+	0x30, 0x31, 0x3a, 0x31, 0x2e, 0x30, 0xa1, 0x61, 0x30, 0xa5, 0x61, 0x32,
+	0x19, 0x01, 0x2c, 0x61, 0x33, 0x18, 0x3c, 0x61, 0x34, 0x18, 0x78, 0x61,
+	0x35, 0x18, 0x5a, 0x62, 0x39, 0x39, 0x1a, 0x66, 0x57, 0x58, 0x6c
+};
+
+/* {"lwm2m": {"14301:1.0": {"0": {"4": 120, "5": 3000000, "99": 1717000800}},
+ * "14302:1.0": {"0": {"8": 5000, "9": 7, "99": 1717000800}}}}
+ */
+static const uint8_t shadow_delta_policy_out_of_range[] = {
+	0xa1, 0x65, 0x6c, 0x77, 0x6d, 0x32, 0x6d, 0xa2, 0x69, 0x31, 0x34, 0x33,
+	0x30, 0x31, 0x3a, 0x31, 0x2e, 0x30, 0xa1, 0x61, 0x30, 0xa3, 0x61, 0x34,
+	0x18, 0x78, 0x61, 0x35, 0x1a, 0x00, 0x2d, 0xc6, 0xc0, 0x62, 0x39, 0x39,
+	0x1a, 0x66, 0x57, 0x5a, 0x60, 0x69, 0x31, 0x34, 0x33, 0x30, 0x32, 0x3a,
+	0x31, 0x2e, 0x30, 0xa1, 0x61, 0x30, 0xa3, 0x61, 0x38, 0x19, 0x13, 0x88,
+	0x61, 0x39, 0x07, 0x62, 0x39, 0x39, 0x1a, 0x66, 0x57, 0x5a, 0x60
+};
+
+/* {"lwm2m": {"14302:1.0": {"0": {"0": 50, "3": -1, "4": 10, "8": 6, "9": 2055,
+ * "99": 1717000400}}}}
+ */
+static const uint8_t shadow_delta_env_config[] = {
+	0xa1, 0x65, 0x6c, 0x77, 0x6d, 0x32, 0x6d, 0xa1, 0x69, 0x31, 0x34, 0x33,
+	0x30, 0x32, 0x3a, 0x31, 0x2e, 0x30, 0xa1, 0x61, 0x30, 0xa6, 0x61, 0x30,
+	0x18, 0x32, 0x61, 0x33, 0x20, 0x61, 0x34, 0x0a, 0x61, 0x38, 0x06, 0x61,
+	0x39, 0x19, 0x08, 0x07, 0x62, 0x39, 0x39, 0x1a, 0x66, 0x57, 0x58, 0xd0
+};
+
+/* {"lwm2m": {"14240:1.0": {"0": {"0": 10, "1": 20, "2": 30, "99": 1717000500}}}} */
+static const uint8_t shadow_delta_led_stored[] = {
+	0xa1, 0x65, 0x6c, 0x77, 0x6d, 0x32, 0x6d, 0xa1, 0x69, 0x31, 0x34, 0x32,
+	0x34, 0x30, 0x3a, 0x31, 0x2e, 0x30, 0xa1, 0x61, 0x30, 0xa4, 0x61, 0x30,
+	0x0a, 0x61, 0x31, 0x14, 0x61, 0x32, 0x18, 0x1e, 0x62, 0x39, 0x39, 0x1a,
+	0x66, 0x57, 0x59, 0x34
+};
+
+#define SHADOW_DELTA_LED_STORED_TIMESTAMP 1717000500
+
+/* {"lwm2m": {"14240:1.0": {"0": {"0": 40, "99": 1717000700}}}} */
+static const uint8_t shadow_delta_led_reported[] = {
+	0xa1, 0x65, 0x6c, 0x77, 0x6d, 0x32, 0x6d, 0xa1, 0x69, 0x31, 0x34, 0x32,
+	0x34, 0x30, 0x3a, 0x31, 0x2e, 0x30, 0xa1, 0x61, 0x30, 0xa2, 0x61, 0x30,
+	0x18, 0x28, 0x62, 0x39, 0x39, 0x1a, 0x66, 0x57, 0x59, 0xfc
+};
+
+/* {"lwm2m": {"14240:1.0": {"0": {"0": 40, "99": 1717000700}},
+ *            "14301:1.0": {"0": {"0": 600, "99": 1717000600}}}}
+ */
+static const uint8_t shadow_delta_report_failed[] = {
+	0xa1, 0x65, 0x6c, 0x77, 0x6d, 0x32, 0x6d, 0xa2, 0x69, 0x31, 0x34, 0x32,
+	0x34, 0x30, 0x3a, 0x31, 0x2e, 0x30, 0xa1, 0x61, 0x30, 0xa2, 0x61, 0x30,
+	0x18, 0x28, 0x62, 0x39, 0x39, 0x1a, 0x66, 0x57, 0x59, 0xfc, 0x69, 0x31,
+	0x34, 0x33, 0x30, 0x31, 0x3a, 0x31, 0x2e, 0x30, 0xa1, 0x61, 0x30, 0xa2,
+	0x61, 0x30, 0x19, 0x02, 0x58, 0x62, 0x39, 0x39, 0x1a, 0x66, 0x57, 0x59,
+	0x98
+};
+
+#define SHADOW_DELTA_LED_REPORTED_TIMESTAMP 1717000700
+#define SHADOW_DELTA_REPORT_FAILED_TIMESTAMP 1717000600
+
+#define SHADOW_DELTA_UPDATE_INTERVAL 120
+#define SHADOW_DELTA_LED_RED 255
+
+static int shadow_get_empty_custom_fake(char *buf, size_t *buf_len, bool delta, int fmt)
+{
+	ARG_UNUSED(buf);
+	ARG_UNUSED(delta);
+	ARG_UNUSED(fmt);
+
+	*buf_len = 0;
+
+	return 0;
+}
+
+static int shadow_get_delta_custom_fake(char *buf, size_t *buf_len, bool delta, int fmt)
+{
+	ARG_UNUSED(delta);
+	ARG_UNUSED(fmt);
+
+	TEST_ASSERT_GREATER_OR_EQUAL(sizeof(shadow_delta), *buf_len);
+
+	memcpy(buf, shadow_delta, sizeof(shadow_delta));
+	*buf_len = sizeof(shadow_delta);
+
+	return 0;
+}
+
+static int shadow_get_delta_led_changed_custom_fake(char *buf, size_t *buf_len, bool delta,
+						    int fmt)
+{
+	ARG_UNUSED(delta);
+	ARG_UNUSED(fmt);
+
+	TEST_ASSERT_GREATER_OR_EQUAL(sizeof(shadow_delta_led_changed), *buf_len);
+
+	memcpy(buf, shadow_delta_led_changed, sizeof(shadow_delta_led_changed));
+	*buf_len = sizeof(shadow_delta_led_changed);
+
+	return 0;
+}
+
+static int shadow_get_delta_config_changed_custom_fake(char *buf, size_t *buf_len, bool delta,
+						       int fmt)
+{
+	ARG_UNUSED(delta);
+	ARG_UNUSED(fmt);
+
+	TEST_ASSERT_GREATER_OR_EQUAL(sizeof(shadow_delta_config_changed), *buf_len);
+
+	memcpy(buf, shadow_delta_config_changed, sizeof(shadow_delta_config_changed));
+	*buf_len = sizeof(shadow_delta_config_changed);
+
+	return 0;
+}
+
+static int shadow_get_delta_led_stored_custom_fake(char *buf, size_t *buf_len, bool delta,
+						   int fmt)
+{
+	ARG_UNUSED(delta);
+	ARG_UNUSED(fmt);
+
+	TEST_ASSERT_GREATER_OR_EQUAL(sizeof(shadow_delta_led_stored), *buf_len);
+
+	memcpy(buf, shadow_delta_led_stored, sizeof(shadow_delta_led_stored));
+	*buf_len = sizeof(shadow_delta_led_stored);
+
+	return 0;
+}
+
+static int shadow_get_delta_led_reported_custom_fake(char *buf, size_t *buf_len, bool delta,
+						     int fmt)
+{
+	ARG_UNUSED(delta);
+	ARG_UNUSED(fmt);
+
+	TEST_ASSERT_GREATER_OR_EQUAL(sizeof(shadow_delta_led_reported), *buf_len);
+
+	memcpy(buf, shadow_delta_led_reported, sizeof(shadow_delta_led_reported));
+	*buf_len = sizeof(shadow_delta_led_reported);
+
+	return 0;
+}
+
+static int shadow_get_delta_report_failed_custom_fake(char *buf, size_t *buf_len, bool delta,
+						      int fmt)
+{
+	ARG_UNUSED(delta);
+	ARG_UNUSED(fmt);
+
+	TEST_ASSERT_GREATER_OR_EQUAL(sizeof(shadow_delta_report_failed), *buf_len);
+
+	memcpy(buf, shadow_delta_report_failed, sizeof(shadow_delta_report_failed));
+	*buf_len = sizeof(shadow_delta_report_failed);
+
+	return 0;
+}
+
+static int shadow_get_delta_policy_out_of_range_custom_fake(char *buf, size_t *buf_len,
+							    bool delta, int fmt)
+{
+	ARG_UNUSED(delta);
+	ARG_UNUSED(fmt);
+
+	TEST_ASSERT_GREATER_OR_EQUAL(sizeof(shadow_delta_policy_out_of_range), *buf_len);
+
+	memcpy(buf, shadow_delta_policy_out_of_range, sizeof(shadow_delta_policy_out_of_range));
+	*buf_len = sizeof(shadow_delta_policy_out_of_range);
+
+	return 0;
+}
+
+static int shadow_get_delta_env_config_custom_fake(char *buf, size_t *buf_len, bool delta,
+						   int fmt)
+{
+	ARG_UNUSED(delta);
+	ARG_UNUSED(fmt);
+
+	TEST_ASSERT_GREATER_OR_EQUAL(sizeof(shadow_delta_env_config), *buf_len);
+
+	memcpy(buf, shadow_delta_env_config, sizeof(shadow_delta_env_config));
+	*buf_len = sizeof(shadow_delta_env_config);
+
+	return 0;
+}
+
+/* Simulates a request that is waiting for a slow network */
+#define SHADOW_GET_SLOW_MS 5000
+
+static int shadow_get_slow_custom_fake(char *buf, size_t *buf_len, bool delta, int fmt)
+{
+	ARG_UNUSED(buf);
+	ARG_UNUSED(delta);
+	ARG_UNUSED(fmt);
+
+	k_sleep(K_MSEC(SHADOW_GET_SLOW_MS));
+
+	*buf_len = 0;
+
+	return 0;
+}
+
+static void send_cloud_connected(void)
+{
+	enum cloud_status status = CLOUD_CONNECTED_READY_TO_SEND;
+	int err = zbus_chan_pub(&CLOUD_CHAN, &status, K_SECONDS(1));
+
+	TEST_ASSERT_EQUAL(0, err);
+}
+
+static void send_cloud_disconnected(void)
+{
+	enum cloud_status status = CLOUD_DISCONNECTED;
+	int err = zbus_chan_pub(&CLOUD_CHAN, &status, K_SECONDS(1));
+
+	TEST_ASSERT_EQUAL(0, err);
+}
+
+static void send_poll_trigger(void)
+{
+	enum trigger_type trigger_type = TRIGGER_POLL;
+	int err = zbus_chan_pub(&TRIGGER_CHAN, &trigger_type, K_SECONDS(1));
+
+	TEST_ASSERT_EQUAL(0, err);
+}
+
+static void send_payload(void)
+{
+	struct payload payload = {
+		.buffer = "uplink",
+		.buffer_len = sizeof("uplink") - 1,
+	};
+	int err = zbus_chan_pub(&PAYLOAD_CHAN, &payload, K_SECONDS(1));
+
+	TEST_ASSERT_EQUAL(0, err);
+}
+
+static void send_button_press(void)
+{
+	uint8_t button_number = 1;
+	int err = zbus_chan_pub(&BUTTON_CHAN, &button_number, K_SECONDS(1));
+
+	TEST_ASSERT_EQUAL(0, err);
+}
+
+/* Collect the objects published since the last call, returns true if any was published */
+static bool published_config_get(struct published_config *config)
+{
+	const struct zbus_channel *chan;
+	uint8_t msg[CHAN_MSG_SIZE_MAX(LED_CONFIG_CHAN, APP_CONFIG_CHAN, ENV_CONFIG_CHAN)];
+
+	memset(config, 0, sizeof(*config));
+
+	while (zbus_sub_wait_msg(&test_subscriber, &chan, msg, K_NO_WAIT) == 0) {
+		if (chan == &LED_CONFIG_CHAN) {
+			config->led_present = true;
+			memcpy(&config->led, msg, sizeof(config->led));
+		} else if (chan == &APP_CONFIG_CHAN) {
+			config->app_present = true;
+			memcpy(&config->app, msg, sizeof(config->app));
+		} else if (chan == &ENV_CONFIG_CHAN) {
+			config->env_present = true;
+			memcpy(&config->env, msg, sizeof(config->env));
+		} else {
+			TEST_FAIL();
+		}
+	}
+
+	return config->led_present || config->app_present || config->env_present;
+}
+
+#define STORED_LED_RED 100
+#define STORED_UPDATE_INTERVAL 900
+#define STORED_HEARTBEAT 4
+
+/* Settings backend that keeps the stored configuration in RAM. It holds the configuration that
+ * was stored at the "last run" when booting, and is updated by the app module.
+ */
+static struct config_stored settings_config = {
+	.version = CONFIG_STORED_VERSION,
+	.led = { .red = STORED_LED_RED, .red_present = true },
+	.config = { .update_interval = STORED_UPDATE_INTERVAL, .update_interval_present = true },
+	.env_config = { .heartbeat = STORED_HEARTBEAT, .heartbeat_present = true },
+	.led_timestamp = 1716000000,
+	.config_timestamp = 1716000100,
+	.env_config_timestamp = 1716000200,
+};
+static int settings_config_saves;
+
+static ssize_t settings_ram_read_cb(void *cb_arg, void *data, size_t len)
+{
+	ARG_UNUSED(cb_arg);
+
+	len = MIN(len, sizeof(settings_config));
+	memcpy(data, &settings_config, len);
+
+	return len;
+}
+
+static int settings_ram_load(struct settings_store *cs, const struct settings_load_arg *arg)
+{
+	ARG_UNUSED(cs);
+
+	return settings_call_set_handler(CONFIG_STORED_SETTINGS_KEY "/" CONFIG_STORED_SETTINGS_NAME,
+					 sizeof(settings_config),
+					 settings_ram_read_cb, NULL, arg);
+}
+
+static int settings_ram_save(struct settings_store *cs, const char *name, const char *value,
+			     size_t val_len)
+{
+	ARG_UNUSED(cs);
+
+	TEST_ASSERT_EQUAL_STRING(CONFIG_STORED_SETTINGS_KEY "/" CONFIG_STORED_SETTINGS_NAME,
+				 name);
+	TEST_ASSERT_EQUAL(sizeof(settings_config), val_len);
+
+	memcpy(&settings_config, value, val_len);
+	settings_config_saves++;
+
+	return 0;
+}
+
+static const struct settings_store_itf settings_ram_itf = {
+	.csi_load = settings_ram_load,
+	.csi_save = settings_ram_save,
+};
+
+static struct settings_store settings_ram_store = {
+	.cs_itf = &settings_ram_itf,
+};
+
+/* Called by settings_subsys_init() with CONFIG_SETTINGS_CUSTOM */
+int settings_backend_init(void)
+{
+	settings_src_register(&settings_ram_store);
+	settings_dst_register(&settings_ram_store);
+
+	return 0;
+}
+
+/* Configuration published by the app module at boot, before the tests run */
+static struct published_config boot_config;
+
+static int boot_config_get(void)
+{
+	(void)published_config_get(&boot_config);
+
+	return 0;
+}
+
+/* Runs after the stored configuration is published at CONFIG_APP_CONFIG_PERSIST_INIT_PRIORITY */
+SYS_INIT(boot_config_get, APPLICATION, 92);
+
+/* Send poll triggers at the frequent poll interval until a configuration is published or
+ * the given number of triggers have been sent. Returns the number of triggers sent until the
+ * configuration was published, or 0 if no configuration was published.
+ */
+static int send_poll_triggers(int count, struct published_config *config)
+{
+	for (int i = 1; i <= count; i++) {
+		send_poll_trigger();
+
+		/* The app module needs CPU to process the trigger */
+		k_sleep(K_MSEC(100));
+
+		if (published_config_get(config)) {
+			return i;
+		}
+
+		k_sleep(K_MSEC(POLL_TRIGGER_INTERVAL_SEC * MSEC_PER_SEC - 100));
+	}
+
+	return 0;
+}
+
+void setUp(void)
+{
+	struct published_config config;
+
+	RESET_FAKE(nrf_cloud_coap_shadow_get);
+	RESET_FAKE(nrf_cloud_coap_patch);
+
+	nrf_cloud_coap_shadow_get_fake.custom_fake = shadow_get_empty_custom_fake;
+
+	(void)published_config_get(&config);
+}
+
+void test_full_shadow_requested_on_cloud_connection(void)
+{
+	send_cloud_connected();
+
+	k_sleep(K_MSEC(100));
+
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_shadow_get_fake.call_count);
+	TEST_ASSERT_FALSE(nrf_cloud_coap_shadow_get_fake.arg2_val);
+}
+
+void test_poll_trigger_right_after_connection_is_skipped(void)
+{
+	send_poll_trigger();
+
+	k_sleep(K_MSEC(100));
+
+	TEST_ASSERT_EQUAL(0, nrf_cloud_coap_shadow_get_fake.call_count);
+}
+
+void test_shadow_polls_per_hour_without_changes(void)
+{
+	struct published_config config;
+
+	k_sleep(K_MSEC(POLL_TRIGGER_INTERVAL_SEC * MSEC_PER_SEC - 100));
+
+	TEST_ASSERT_EQUAL(0, send_poll_triggers(POLL_TRIGGERS_PER_HOUR, &config));
+
+	LOG_INF("Shadow polls per hour: %d, poll triggers: %d",
+		nrf_cloud_coap_shadow_get_fake.call_count, POLL_TRIGGERS_PER_HOUR);
+
+	TEST_ASSERT_LESS_OR_EQUAL(SHADOW_POLLS_PER_HOUR_MAX,
+				  nrf_cloud_coap_shadow_get_fake.call_count);
+	TEST_ASSERT_TRUE(nrf_cloud_coap_shadow_get_fake.arg2_val);
+	TEST_ASSERT_EQUAL(0, nrf_cloud_coap_patch_fake.call_count);
+}
+
+void test_shadow_change_applied_within_max_poll_interval(void)
+{
+	int triggers;
+	struct published_config config = { 0 };
+
+	/* The desired state changes while polling is backed off to the maximum interval */
+	nrf_cloud_coap_shadow_get_fake.custom_fake = shadow_get_delta_custom_fake;
+
+	triggers = send_poll_triggers(POLL_TRIGGERS_PER_HOUR, &config);
+	TEST_ASSERT_NOT_EQUAL(0, triggers);
+
+	LOG_INF("Configuration change applied after %d seconds",
+		(triggers - 1) * POLL_TRIGGER_INTERVAL_SEC);
+
+	TEST_ASSERT_LESS_OR_EQUAL(CONFIG_APP_SHADOW_POLL_INTERVAL_MAX_SECONDS,
+				  (triggers - 1) * POLL_TRIGGER_INTERVAL_SEC);
+	TEST_ASSERT_TRUE(config.app_present);
+	TEST_ASSERT_TRUE(config.app.update_interval_present);
+	TEST_ASSERT_EQUAL(SHADOW_DELTA_UPDATE_INTERVAL, config.app.update_interval);
+
+	/* The reported state is sent together with the next uplink */
+	TEST_ASSERT_EQUAL(0, nrf_cloud_coap_patch_fake.call_count);
+
+	send_payload();
+	k_sleep(K_MSEC(100));
+
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_patch_fake.call_count);
+	TEST_ASSERT_EQUAL(sizeof(shadow_delta), nrf_cloud_coap_patch_fake.arg3_val);
+
+	/* Received changes reset the poll interval to the minimum */
+	k_sleep(K_MSEC(POLL_TRIGGER_INTERVAL_SEC * MSEC_PER_SEC - 100));
+
+	RESET_FAKE(nrf_cloud_coap_shadow_get);
+	nrf_cloud_coap_shadow_get_fake.custom_fake = shadow_get_delta_custom_fake;
+
+	/* The same delta is neither applied nor reported again */
+	TEST_ASSERT_EQUAL(0, send_poll_triggers(1, &config));
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_shadow_get_fake.call_count);
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_patch_fake.call_count);
+}
+
+void test_only_changed_objects_are_applied(void)
+{
+	int triggers;
+	struct published_config config = { 0 };
+
+	/* The LED object is updated, while the configuration object is the instance that has
+	 * already been applied.
+	 */
+	nrf_cloud_coap_shadow_get_fake.custom_fake = shadow_get_delta_led_changed_custom_fake;
+
+	triggers = send_poll_triggers(POLL_TRIGGERS_PER_HOUR, &config);
+	TEST_ASSERT_NOT_EQUAL(0, triggers);
+
+	TEST_ASSERT_TRUE(config.led_present);
+	TEST_ASSERT_TRUE(config.led.red_present);
+	TEST_ASSERT_EQUAL(SHADOW_DELTA_LED_RED, config.led.red);
+	TEST_ASSERT_FALSE(config.app_present);
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_patch_fake.call_count);
+}
+
+void test_report_sent_after_max_delay_without_uplink(void)
+{
+	struct published_config config = { 0 };
+
+	nrf_cloud_coap_shadow_get_fake.custom_fake = shadow_get_delta_config_changed_custom_fake;
+
+	TEST_ASSERT_NOT_EQUAL(0, send_poll_triggers(POLL_TRIGGERS_PER_HOUR, &config));
+	TEST_ASSERT_EQUAL(0, nrf_cloud_coap_patch_fake.call_count);
+
+	k_sleep(K_SECONDS(CONFIG_APP_REPORT_DELAY_MAX_SECONDS));
+
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_patch_fake.call_count);
+	TEST_ASSERT_EQUAL(sizeof(shadow_delta_config_changed),
+			  nrf_cloud_coap_patch_fake.arg3_val);
+}
+
+void test_env_config_applied(void)
+{
+	struct published_config config = { 0 };
+
+	nrf_cloud_coap_shadow_get_fake.custom_fake = shadow_get_delta_env_config_custom_fake;
+
+	TEST_ASSERT_NOT_EQUAL(0, send_poll_triggers(POLL_TRIGGERS_PER_HOUR, &config));
+
+	TEST_ASSERT_FALSE(config.led_present);
+	TEST_ASSERT_FALSE(config.app_present);
+	TEST_ASSERT_TRUE(config.env_present);
+	TEST_ASSERT_TRUE(config.env.temperature.absolute_present);
+	TEST_ASSERT_EQUAL(50, config.env.temperature.absolute);
+	TEST_ASSERT_TRUE(config.env.temperature.relative_present);
+	TEST_ASSERT_EQUAL(10, config.env.temperature.relative);
+	TEST_ASSERT_FALSE(config.env.humidity.absolute_present);
+
+	/* Negative deadbands are ignored */
+	TEST_ASSERT_FALSE(config.env.iaq.absolute_present);
+
+	TEST_ASSERT_TRUE(config.env.heartbeat_present);
+	TEST_ASSERT_EQUAL(6, config.env.heartbeat);
+
+	/* Temperature, humidity, pressure and CO2 */
+	TEST_ASSERT_TRUE(config.env.resources_present);
+	TEST_ASSERT_EQUAL(ENV_RESOURCE_TEMPERATURE | ENV_RESOURCE_HUMIDITY |
+			  ENV_RESOURCE_PRESSURE | ENV_RESOURCE_CO2, config.env.resources);
+
+	/* Send the pending report */
+	send_payload();
+	k_sleep(K_MSEC(100));
+
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_patch_fake.call_count);
+}
+
+void test_policy_value_out_of_range_ignored(void)
+{
+	struct published_config config = { 0 };
+
+	nrf_cloud_coap_shadow_get_fake.custom_fake =
+		shadow_get_delta_policy_out_of_range_custom_fake;
+
+	TEST_ASSERT_NOT_EQUAL(0, send_poll_triggers(POLL_TRIGGERS_PER_HOUR, &config));
+
+	/* A location timeout of 3000000 seconds overflows when given in milliseconds */
+	TEST_ASSERT_TRUE(config.app_present);
+	TEST_ASSERT_FALSE(config.app.location_timeout_present);
+	TEST_ASSERT_TRUE(config.app.reconnection_timeout_present);
+	TEST_ASSERT_EQUAL(120, config.app.reconnection_timeout);
+
+	/* A heartbeat above ENV_HEARTBEAT_INTERVALS_MAX is ignored */
+	TEST_ASSERT_TRUE(config.env_present);
+	TEST_ASSERT_FALSE(config.env.heartbeat_present);
+	TEST_ASSERT_TRUE(config.env.resources_present);
+	TEST_ASSERT_EQUAL(7, config.env.resources);
+
+	/* Send the pending report */
+	send_payload();
+	k_sleep(K_MSEC(100));
+
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_patch_fake.call_count);
+}
+
+void test_config_restored_at_boot(void)
+{
+	/* The stored objects are published without a cloud connection */
+	TEST_ASSERT_TRUE(boot_config.led_present);
+	TEST_ASSERT_TRUE(boot_config.led.red_present);
+	TEST_ASSERT_EQUAL(STORED_LED_RED, boot_config.led.red);
+	TEST_ASSERT_FALSE(boot_config.led.green_present);
+
+	TEST_ASSERT_TRUE(boot_config.app_present);
+	TEST_ASSERT_TRUE(boot_config.app.update_interval_present);
+	TEST_ASSERT_EQUAL(STORED_UPDATE_INTERVAL, boot_config.app.update_interval);
+	TEST_ASSERT_FALSE(boot_config.app.gnss_present);
+
+	TEST_ASSERT_TRUE(boot_config.env_present);
+	TEST_ASSERT_TRUE(boot_config.env.heartbeat_present);
+	TEST_ASSERT_EQUAL(STORED_HEARTBEAT, boot_config.env.heartbeat);
+	TEST_ASSERT_FALSE(boot_config.env.resources_present);
+}
+
+void test_applied_config_stored(void)
+{
+	struct published_config config = { 0 };
+
+	settings_config_saves = 0;
+	nrf_cloud_coap_shadow_get_fake.custom_fake = shadow_get_delta_led_stored_custom_fake;
+
+	TEST_ASSERT_NOT_EQUAL(0, send_poll_triggers(POLL_TRIGGERS_PER_HOUR, &config));
+	TEST_ASSERT_TRUE(config.led_present);
+
+	/* The applied LED object is merged into the stored one, the other objects are kept */
+	TEST_ASSERT_EQUAL(1, settings_config_saves);
+	TEST_ASSERT_EQUAL(SHADOW_DELTA_LED_STORED_TIMESTAMP, settings_config.led_timestamp);
+	TEST_ASSERT_EQUAL(10, settings_config.led.red);
+	TEST_ASSERT_EQUAL(20, settings_config.led.green);
+	TEST_ASSERT_EQUAL(30, settings_config.led.blue);
+	TEST_ASSERT_TRUE(settings_config.led.blue_present);
+	TEST_ASSERT_NOT_EQUAL(0, settings_config.config_timestamp);
+	TEST_ASSERT_NOT_EQUAL(0, settings_config.env_config_timestamp);
+}
+
+void test_config_not_stored_if_report_fails(void)
+{
+	struct published_config config = { 0 };
+
+	/* An LED object is applied and reported */
+	nrf_cloud_coap_shadow_get_fake.custom_fake = shadow_get_delta_led_reported_custom_fake;
+
+	TEST_ASSERT_NOT_EQUAL(0, send_poll_triggers(POLL_TRIGGERS_PER_HOUR, &config));
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_patch_fake.call_count);
+	TEST_ASSERT_EQUAL(SHADOW_DELTA_LED_REPORTED_TIMESTAMP, settings_config.led_timestamp);
+
+	/* A configuration object is applied next to the reported LED object, and reporting
+	 * it fails.
+	 */
+	settings_config_saves = 0;
+	nrf_cloud_coap_patch_fake.return_val = -ETIMEDOUT;
+	nrf_cloud_coap_shadow_get_fake.custom_fake = shadow_get_delta_report_failed_custom_fake;
+
+	TEST_ASSERT_NOT_EQUAL(0, send_poll_triggers(POLL_TRIGGERS_PER_HOUR, &config));
+	TEST_ASSERT_FALSE(config.led_present);
+	TEST_ASSERT_TRUE(config.app_present);
+
+	send_payload();
+	k_sleep(K_MSEC(100));
+
+	TEST_ASSERT_EQUAL(2, nrf_cloud_coap_patch_fake.call_count);
+	TEST_ASSERT_EQUAL(0, settings_config_saves);
+	TEST_ASSERT_NOT_EQUAL(SHADOW_DELTA_REPORT_FAILED_TIMESTAMP,
+			      settings_config.config_timestamp);
+	TEST_ASSERT_EQUAL(SHADOW_DELTA_LED_REPORTED_TIMESTAMP, settings_config.led_timestamp);
+
+	/* Only the object of the failed report is applied again from the same shadow, and
+	 * stored once it has been reported.
+	 */
+	nrf_cloud_coap_patch_fake.return_val = 0;
+
+	TEST_ASSERT_NOT_EQUAL(0, send_poll_triggers(POLL_TRIGGERS_PER_HOUR, &config));
+	TEST_ASSERT_FALSE(config.led_present);
+	TEST_ASSERT_TRUE(config.app_present);
+	TEST_ASSERT_EQUAL(600, config.app.update_interval);
+
+	send_payload();
+	k_sleep(K_MSEC(100));
+
+	TEST_ASSERT_EQUAL(3, nrf_cloud_coap_patch_fake.call_count);
+	TEST_ASSERT_EQUAL(1, settings_config_saves);
+	TEST_ASSERT_EQUAL(SHADOW_DELTA_REPORT_FAILED_TIMESTAMP, settings_config.config_timestamp);
+	TEST_ASSERT_EQUAL(SHADOW_DELTA_LED_REPORTED_TIMESTAMP, settings_config.led_timestamp);
+}
+
+void test_button_press_resets_poll_interval(void)
+{
+	struct published_config config;
+
+	/* Back off the poll interval */
+	k_sleep(K_MSEC(POLL_TRIGGER_INTERVAL_SEC * MSEC_PER_SEC - 100));
+	send_poll_triggers(POLL_TRIGGERS_PER_HOUR / 4, &config);
+
+	RESET_FAKE(nrf_cloud_coap_shadow_get);
+	nrf_cloud_coap_shadow_get_fake.custom_fake = shadow_get_empty_custom_fake;
+
+	send_button_press();
+	send_poll_trigger();
+
+	k_sleep(K_MSEC(100));
+
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_shadow_get_fake.call_count);
+	TEST_ASSERT_TRUE(nrf_cloud_coap_shadow_get_fake.arg2_val);
+}
+
+void test_requests_coalesced_while_request_in_progress(void)
+{
+	nrf_cloud_coap_shadow_get_fake.custom_fake = shadow_get_slow_custom_fake;
+	RESET_FAKE(supervisor_checkin);
+
+	send_cloud_connected();
+	k_sleep(K_MSEC(100));
+
+	/* Messages are processed while the request is in progress */
+	send_cloud_connected();
+	send_cloud_connected();
+
+	for (int i = 0; i < 5; i++) {
+		send_poll_trigger();
+	}
+
+	k_sleep(K_MSEC(100));
+
+	/* 8 messages by the module thread, and the shadow work item that is in progress */
+	TEST_ASSERT_EQUAL(9, supervisor_checkin_fake.call_count);
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_shadow_get_fake.call_count);
+
+	/* The pending requests are handled as a single full shadow request */
+	k_sleep(K_MSEC(SHADOW_GET_SLOW_MS * 3));
+
+	TEST_ASSERT_EQUAL(2, nrf_cloud_coap_shadow_get_fake.call_count);
+	TEST_ASSERT_FALSE(nrf_cloud_coap_shadow_get_fake.arg2_history[1]);
+}
+
+void test_shadow_queue_supervised(void)
+{
+	TEST_ASSERT_EQUAL(1, supervisor_add_work_queue_fake.call_count);
+	TEST_ASSERT_EQUAL(CONFIG_APP_MODULE_WATCHDOG_TIMEOUT_SECONDS * MSEC_PER_SEC,
+			  supervisor_add_work_queue_fake.arg1_val);
+
+	RESET_FAKE(supervisor_checkin);
+	RESET_FAKE(supervisor_checkout);
+
+	send_cloud_connected();
+	k_sleep(K_MSEC(100));
+
+	/* The module thread and the shadow work item both check in and out */
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_shadow_get_fake.call_count);
+	TEST_ASSERT_EQUAL(2, supervisor_checkin_fake.call_count);
+	TEST_ASSERT_EQUAL(2, supervisor_checkout_fake.call_count);
+}
+
+void test_pending_requests_cancelled_on_disconnect(void)
+{
+	nrf_cloud_coap_shadow_get_fake.custom_fake = shadow_get_slow_custom_fake;
+
+	send_cloud_connected();
+	k_sleep(K_MSEC(100));
+
+	send_cloud_connected();
+	send_cloud_disconnected();
+
+	k_sleep(K_MSEC(SHADOW_GET_SLOW_MS * 2));
+
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_shadow_get_fake.call_count);
+}
+
+void test_shadow_decode_skips_unknown_entries(void)
+{
+	int err;
+	struct shadow_objects objects;
+
+	err = shadow_decode(shadow_unknown_entries, sizeof(shadow_unknown_entries), &objects);
+	TEST_ASSERT_EQUAL(0, err);
+
+	TEST_ASSERT_TRUE(objects.led_present);
+	TEST_ASSERT_FALSE(objects.config_present);
+	TEST_ASSERT_EQUAL(1, objects.led._0._0._0);
+	TEST_ASSERT_EQUAL(2, objects.led._0._1._1);
+	TEST_ASSERT_EQUAL(3, objects.led._0._2._2);
+	TEST_ASSERT_EQUAL(5, objects.led._0._99);
+}
+
+void test_shadow_decode_policy(void)
+{
+	int err;
+	struct shadow_objects objects;
+
+	err = shadow_decode(shadow_delta_policy, sizeof(shadow_delta_policy), &objects);
+	TEST_ASSERT_EQUAL(0, err);
+
+	TEST_ASSERT_TRUE(objects.config_present);
+	TEST_ASSERT_FALSE(objects.config._0._0_present);
+	TEST_ASSERT_TRUE(objects.config._0._2_present);
+	TEST_ASSERT_EQUAL(300, objects.config._0._2._2);
+	TEST_ASSERT_TRUE(objects.config._0._3_present);
+	TEST_ASSERT_EQUAL(60, objects.config._0._3._3);
+	TEST_ASSERT_TRUE(objects.config._0._4_present);
+	TEST_ASSERT_EQUAL(120, objects.config._0._4._4);
+	TEST_ASSERT_TRUE(objects.config._0._5_present);
+	TEST_ASSERT_EQUAL(90, objects.config._0._5._5);
+}
+
+void test_shadow_decode_truncated(void)
+{
+	int err;
+	struct shadow_objects objects;
+
+	err = shadow_decode(shadow_unknown_entries, sizeof(shadow_unknown_entries) - 1, &objects);
+	TEST_ASSERT_EQUAL(-EBADMSG, err);
+
+	err = shadow_decode(shadow_delta, sizeof(shadow_delta) / 2, &objects);
+	TEST_ASSERT_EQUAL(-EBADMSG, err);
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
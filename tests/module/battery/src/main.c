@@ -0,0 +1,393 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <unity.h>
+
+#include <zephyr/fff.h>
+#include <zephyr/zbus/zbus.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/drivers/sensor/npm13xx_charger.h>
+
+#include "message_channel.h"
+#include "supervisor.h"
+
+#include "zcbor_decode.h"
+#include "bat_object_decode.h"
+
+DEFINE_FFF_GLOBALS;
+
+FAKE_VALUE_FUNC(int, date_time_now, int64_t *);
+FAKE_VALUE_FUNC(int, date_time_uptime_to_unix_time_ms, int64_t *);
+FAKE_VALUE_FUNC(int, supervisor_add, const struct zbus_observer *, uint32_t);
+FAKE_VOID_FUNC(supervisor_checkin, int);
+FAKE_VOID_FUNC(supervisor_checkout, int);
+
+/* The fuel gauge library is not built for native_sim. Its structures are only passed by
+ * pointer, so they are not needed here.
+ */
+FAKE_VALUE_FUNC(int, nrf_fuel_gauge_init, const void *, void *);
+FAKE_VALUE_FUNC(float, nrf_fuel_gauge_process, float, float, float, float, void *);
+
+LOG_MODULE_REGISTER(battery_module_test, 4);
+
+ZBUS_MSG_SUBSCRIBER_DEFINE(test_subscriber);
+ZBUS_CHAN_ADD_OBS(PAYLOAD_CHAN, test_subscriber, 0);
+
+#define FAKE_TIME_MS 1723099642000
+#define FAKE_VOLTAGE 3.7
+#define FAKE_CURRENT -0.05
+#define FAKE_TEMPERATURE 24.5
+#define FAKE_STATE_OF_CHARGE 80
+
+#define UPDATE_INTERVAL_SEC CONFIG_APP_BATTERY_FUEL_GAUGE_UPDATE_INTERVAL_SECONDS
+
+/* Samples triggered before time is available in suiteSetUp(), and the time between them */
+#define SAMPLES_BEFORE_TIME 2
+#define SAMPLES_BEFORE_TIME_INTERVAL_MS 2000
+
+/* Payloads sent for the samples triggered before time is available */
+static struct payload before_time_payloads[SAMPLES_BEFORE_TIME];
+static size_t before_time_payload_count;
+static bool before_time_early;
+static unsigned int before_time_conversions;
+
+/* Fuel gauge updates done for the first sample, before the periodic update has run */
+static unsigned int first_sample_updates;
+
+/* Measurements returned by the fake charger, and the error returned when it is fetched */
+static double charger_voltage = FAKE_VOLTAGE;
+static double charger_current = FAKE_CURRENT;
+static double charger_temperature = FAKE_TEMPERATURE;
+static int charger_fetch_err;
+
+static unsigned int fatal_errors;
+
+static int charger_fake_sample_fetch(const struct device *dev, enum sensor_channel chan)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(chan);
+
+	return charger_fetch_err;
+}
+
+static int charger_fake_channel_get(const struct device *dev, enum sensor_channel chan,
+				    struct sensor_value *val)
+{
+	ARG_UNUSED(dev);
+
+	switch ((int)chan) {
+	case SENSOR_CHAN_GAUGE_VOLTAGE:
+		return sensor_value_from_double(val, charger_voltage);
+	case SENSOR_CHAN_GAUGE_AVG_CURRENT:
+		return sensor_value_from_double(val, charger_current);
+	case SENSOR_CHAN_GAUGE_TEMP:
+		return sensor_value_from_double(val, charger_temperature);
+	case SENSOR_CHAN_NPM13XX_CHARGER_STATUS:
+	case SENSOR_CHAN_GAUGE_DESIRED_CHARGING_CURRENT:
+		val->val1 = 0;
+		val->val2 = 0;
+		return 0;
+	default:
+		return -ENOTSUP;
+	}
+}
+
+static const struct sensor_driver_api charger_fake_api = {
+	.sample_fetch = charger_fake_sample_fetch,
+	.channel_get = charger_fake_channel_get,
+};
+
+DEVICE_DT_DEFINE(DT_NODELABEL(npm1300_charger), NULL, NULL, NULL, NULL, POST_KERNEL,
+		 CONFIG_SENSOR_INIT_PRIORITY, &charger_fake_api);
+
+static void error_cb(const struct zbus_channel *chan)
+{
+	enum error_type type = *(enum error_type *)chan->message;
+
+	if (type == ERROR_FATAL) {
+		fatal_errors++;
+	}
+}
+
+ZBUS_LISTENER_DEFINE(test_error_listener, error_cb);
+ZBUS_CHAN_ADD_OBS(ERROR_CHAN, test_error_listener, 0);
+
+static int date_time_now_custom_fake(int64_t *time)
+{
+	*time = FAKE_TIME_MS;
+	return 0;
+}
+
+/* Uptimes are converted relative to the current time, FAKE_TIME_MS */
+static int date_time_uptime_to_unix_time_ms_custom_fake(int64_t *uptime)
+{
+	*uptime = FAKE_TIME_MS - (k_uptime_get() - *uptime);
+	return 0;
+}
+
+static void send_time_available(void)
+{
+	enum time_status time_type = TIME_AVAILABLE;
+	int err = zbus_chan_pub(&TIME_CHAN, &time_type, K_SECONDS(1));
+
+	TEST_ASSERT_EQUAL(0, err);
+}
+
+static void send_trigger(void)
+{
+	enum trigger_type trigger_type = TRIGGER_DATA_SAMPLE;
+	int err = zbus_chan_pub(&TRIGGER_CHAN, &trigger_type, K_SECONDS(1));
+
+	TEST_ASSERT_EQUAL(0, err);
+}
+
+static void wait_for_and_decode_payload(struct bat_object *bat_object)
+{
+	const struct zbus_channel *chan;
+	static struct payload received_payload;
+	int err;
+
+	/* Allow the test thread to sleep so that the DUT's thread is allowed to run. */
+	k_sleep(K_MSEC(100));
+
+	err = zbus_sub_wait_msg(&test_subscriber, &chan, &received_payload, K_MSEC(1000));
+	TEST_ASSERT_EQUAL(0, err);
+	TEST_ASSERT_EQUAL_PTR(&PAYLOAD_CHAN, chan);
+
+	err = cbor_decode_bat_object(received_payload.buffer, received_payload.buffer_len,
+				     bat_object, NULL);
+	TEST_ASSERT_EQUAL(ZCBOR_SUCCESS, err);
+}
+
+/* Wait until the periodic fuel gauge update has just run, so that the next one is a whole
+ * interval away.
+ */
+static void wait_for_update(void)
+{
+	unsigned int calls = nrf_fuel_gauge_process_fake.call_count;
+
+	for (int i = 0; i < (UPDATE_INTERVAL_SEC * 200); i++) {
+		k_sleep(K_MSEC(10));
+
+		if (nrf_fuel_gauge_process_fake.call_count != calls) {
+			return;
+		}
+	}
+
+	TEST_FAIL_MESSAGE("No fuel gauge update");
+}
+
+void suiteSetUp(void)
+{
+	const struct zbus_channel *chan;
+	enum time_status time_status = TIME_AVAILABLE;
+	struct payload payload;
+
+	nrf_fuel_gauge_process_fake.return_val = FAKE_STATE_OF_CHARGE;
+	date_time_uptime_to_unix_time_ms_fake.custom_fake =
+		date_time_uptime_to_unix_time_ms_custom_fake;
+
+	/* The first trigger is handled right after the module has started, before the first
+	 * periodic update. The second one uses the latest periodic update.
+	 */
+	for (int i = 0; i < SAMPLES_BEFORE_TIME; i++) {
+		enum trigger_type trigger_type = TRIGGER_DATA_SAMPLE;
+
+		(void)zbus_chan_pub(&TRIGGER_CHAN, &trigger_type, K_SECONDS(1));
+
+		if (i == 0) {
+			k_sleep(K_MSEC(100));
+			first_sample_updates = nrf_fuel_gauge_process_fake.call_count;
+		}
+
+		k_sleep(K_MSEC(SAMPLES_BEFORE_TIME_INTERVAL_MS));
+	}
+
+	before_time_early = (zbus_sub_wait_msg(&test_subscriber, &chan, &payload,
+					       K_NO_WAIT) == 0);
+
+	(void)zbus_chan_pub(&TIME_CHAN, &time_status, K_SECONDS(1));
+
+	while ((before_time_payload_count < SAMPLES_BEFORE_TIME) &&
+	       (zbus_sub_wait_msg(&test_subscriber, &chan,
+				  &before_time_payloads[before_time_payload_count],
+				  K_MSEC(1000)) == 0)) {
+		before_time_payload_count++;
+	}
+
+	before_time_conversions = date_time_uptime_to_unix_time_ms_fake.call_count;
+}
+
+void setUp(void)
+{
+	RESET_FAKE(supervisor_checkin);
+	RESET_FAKE(supervisor_checkout);
+	RESET_FAKE(date_time_now);
+
+	date_time_now_fake.custom_fake = date_time_now_custom_fake;
+	nrf_fuel_gauge_process_fake.return_val = FAKE_STATE_OF_CHARGE;
+	charger_voltage = FAKE_VOLTAGE;
+	charger_current = FAKE_CURRENT;
+	charger_temperature = FAKE_TEMPERATURE;
+	charger_fetch_err = 0;
+	fatal_errors = 0;
+
+	send_time_available();
+}
+
+void tearDown(void)
+{
+	const struct zbus_channel *chan;
+	static struct payload received_payload;
+	int err;
+
+	err = zbus_sub_wait_msg(&test_subscriber, &chan, &received_payload, K_MSEC(1000));
+	if (err == 0) {
+		LOG_ERR("Unhandled message in payload channel");
+		TEST_FAIL();
+	}
+
+	TEST_ASSERT_EQUAL_MESSAGE(0, fatal_errors, "Fatal error sent");
+}
+
+void test_samples_before_time(void)
+{
+	int err;
+	static struct bat_object bat_object[SAMPLES_BEFORE_TIME];
+
+	/* Given
+	 * Samples triggered before time is available, in suiteSetUp()
+	 */
+	TEST_ASSERT_FALSE_MESSAGE(before_time_early, "Payload sent before time was available");
+
+	/* Then
+	 * The first sample updated the fuel gauge itself, the periodic update had not run yet.
+	 * The samples are sent once time is available, timestamped from the uptime when they
+	 * were taken.
+	 */
+	TEST_ASSERT_EQUAL(1, first_sample_updates);
+	TEST_ASSERT_EQUAL(SAMPLES_BEFORE_TIME, before_time_payload_count);
+	TEST_ASSERT_EQUAL(SAMPLES_BEFORE_TIME, before_time_conversions);
+
+	for (size_t i = 0; i < SAMPLES_BEFORE_TIME; i++) {
+		err = cbor_decode_bat_object(before_time_payloads[i].buffer,
+					     before_time_payloads[i].buffer_len,
+					     &bat_object[i], NULL);
+		TEST_ASSERT_EQUAL(ZCBOR_SUCCESS, err);
+		TEST_ASSERT_EQUAL(FAKE_STATE_OF_CHARGE, bat_object[i].state_of_charge_m.vi);
+		TEST_ASSERT_FLOAT_WITHIN(0.001, FAKE_VOLTAGE, bat_object[i].voltage_m.vf);
+		TEST_ASSERT_LESS_THAN(FAKE_TIME_MS / 1000, bat_object[i].state_of_charge_m.bt);
+	}
+
+	/* The samples are sent in order, as far apart as they were taken */
+	TEST_ASSERT_INT_WITHIN(1, SAMPLES_BEFORE_TIME_INTERVAL_MS / 1000,
+			       bat_object[1].state_of_charge_m.bt -
+			       bat_object[0].state_of_charge_m.bt);
+}
+
+void test_fuel_gauge_updated_periodically(void)
+{
+	unsigned int calls;
+
+	/* Given */
+	wait_for_update();
+	calls = nrf_fuel_gauge_process_fake.call_count;
+
+	/* When
+	 * No data sample is triggered
+	 */
+	k_sleep(K_MSEC(3 * UPDATE_INTERVAL_SEC * MSEC_PER_SEC + 100));
+
+	/* Then
+	 * The fuel gauge is updated once per interval from the charger measurements, and
+	 * nothing is sent
+	 */
+	TEST_ASSERT_EQUAL(calls + 3, nrf_fuel_gauge_process_fake.call_count);
+	TEST_ASSERT_FLOAT_WITHIN(0.001, FAKE_VOLTAGE, nrf_fuel_gauge_process_fake.arg0_val);
+	TEST_ASSERT_FLOAT_WITHIN(0.001, FAKE_CURRENT, nrf_fuel_gauge_process_fake.arg1_val);
+	TEST_ASSERT_FLOAT_WITHIN(0.001, FAKE_TEMPERATURE, nrf_fuel_gauge_process_fake.arg2_val);
+	TEST_ASSERT_FLOAT_WITHIN(0.1, UPDATE_INTERVAL_SEC, nrf_fuel_gauge_process_fake.arg3_val);
+}
+
+void test_sample_from_latest_update(void)
+{
+	static struct bat_object bat_object = {0};
+	unsigned int calls;
+
+	/* Given
+	 * A fuel gauge update, then charger values that have not been processed yet
+	 */
+	wait_for_update();
+	calls = nrf_fuel_gauge_process_fake.call_count;
+
+	charger_voltage = FAKE_VOLTAGE - 0.5;
+	nrf_fuel_gauge_process_fake.return_val = FAKE_STATE_OF_CHARGE - 10;
+
+	/* When */
+	send_trigger();
+
+	/* Then
+	 * The sample is taken from the latest update, without updating the fuel gauge
+	 */
+	wait_for_and_decode_payload(&bat_object);
+	TEST_ASSERT_EQUAL(calls, nrf_fuel_gauge_process_fake.call_count);
+	TEST_ASSERT_EQUAL(FAKE_TIME_MS / 1000, bat_object.state_of_charge_m.bt);
+	TEST_ASSERT_EQUAL(FAKE_STATE_OF_CHARGE, bat_object.state_of_charge_m.vi);
+	TEST_ASSERT_FLOAT_WITHIN(0.001, FAKE_VOLTAGE, bat_object.voltage_m.vf);
+	TEST_ASSERT_FLOAT_WITHIN(0.001, FAKE_TEMPERATURE, bat_object.temperature_m.vf);
+}
+
+void test_charger_read_error_skips_update(void)
+{
+	static struct bat_object bat_object = {0};
+	unsigned int calls;
+
+	/* Given */
+	wait_for_update();
+	calls = nrf_fuel_gauge_process_fake.call_count;
+
+	/* When
+	 * The charger cannot be read for two update intervals
+	 */
+	charger_fetch_err = -EIO;
+	k_sleep(K_MSEC(2 * UPDATE_INTERVAL_SEC * MSEC_PER_SEC + 100));
+
+	/* Then
+	 * The updates are skipped without a fatal error, and samples use the last update
+	 */
+	TEST_ASSERT_EQUAL(calls, nrf_fuel_gauge_process_fake.call_count);
+	TEST_ASSERT_EQUAL(0, fatal_errors);
+
+	send_trigger();
+	wait_for_and_decode_payload(&bat_object);
+	TEST_ASSERT_EQUAL(FAKE_STATE_OF_CHARGE, bat_object.state_of_charge_m.vi);
+
+	/* When
+	 * The charger can be read again
+	 */
+	charger_fetch_err = 0;
+	wait_for_update();
+
+	/* Then
+	 * The next update integrates over the skipped intervals
+	 */
+	TEST_ASSERT_FLOAT_WITHIN(0.2, 3 * UPDATE_INTERVAL_SEC,
+				 nrf_fuel_gauge_process_fake.arg3_val);
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
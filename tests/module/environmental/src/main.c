@@ -7,20 +7,29 @@
 
 #include <zephyr/fff.h>
 #include <zephyr/zbus/zbus.h>
-#include <zephyr/task_wdt/task_wdt.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/pm/device.h>
 
 #include "message_channel.h"
+#include "supervisor.h"
 #include "gas_sensor.h"
+#include "environmental.h"
 
 #include "zcbor_decode.h"
 #include "env_object_decode.h"
 
+#if defined(CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING)
+/* Generated at build time from drivers/sensor/gas_sensor_dummy/traces/meeting_room.csv */
+#include "meeting_room_trace.h"
+#endif /* CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING */
+
 DEFINE_FFF_GLOBALS;
 
 FAKE_VALUE_FUNC(int, date_time_now, int64_t *);
-FAKE_VALUE_FUNC(int, task_wdt_feed, int);
-FAKE_VALUE_FUNC(int, task_wdt_add, uint32_t, task_wdt_callback_t, void *);
+FAKE_VALUE_FUNC(int, date_time_uptime_to_unix_time_ms, int64_t *);
+FAKE_VALUE_FUNC(int, supervisor_add, const struct zbus_observer *, uint32_t);
+FAKE_VOID_FUNC(supervisor_checkin, int);
+FAKE_VOID_FUNC(supervisor_checkout, int);
 
 LOG_MODULE_REGISTER(environmental_module_test, 4);
 
@@ -33,7 +42,25 @@ ZBUS_CHAN_ADD_OBS(PAYLOAD_CHAN, transport, 0);
 #define SENSOR_HUMIDITY 50.0
 #define SENSOR_IAQ 100
 #define SENSOR_CO2 400
-#define SENSOR_VOC 100
+#define SENSOR_VOC 1.5
+
+#if defined(CONFIG_APP_ENVIRONMENTAL_SERIES)
+#define TRIGGERS_PER_PAYLOAD CONFIG_APP_ENVIRONMENTAL_SERIES_SAMPLES
+#else
+#define TRIGGERS_PER_PAYLOAD 1
+#endif
+
+/* Time between the samples of a series in test_series() */
+#define SERIES_INTERVAL_MS 60000
+
+static int64_t fake_time_ms;
+
+/* Payload sent for the samples triggered before time is available, see suiteSetUp() */
+static struct payload before_time_payload;
+static int before_time_err;
+static bool before_time_early;
+static unsigned int before_time_conversions;
+static unsigned int before_time_now_calls;
 
 static const struct device *const sensor_dev = DEVICE_DT_GET(DT_ALIAS(gas_sensor));
 
@@ -43,6 +70,20 @@ static int date_time_now_custom_fake(int64_t *time)
 	return 0;
 }
 
+/* Uptimes are converted relative to the current time, FAKE_TIME_MS */
+static int date_time_uptime_to_unix_time_ms_custom_fake(int64_t *uptime)
+{
+	*uptime = FAKE_TIME_MS - (k_uptime_get() - *uptime);
+	return 0;
+}
+
+static int date_time_now_advancing_custom_fake(int64_t *time)
+{
+	*time = fake_time_ms;
+	fake_time_ms += SERIES_INTERVAL_MS;
+	return 0;
+}
+
 static void send_time_available(void)
 {
 	enum time_status time_type = TIME_AVAILABLE;
@@ -51,7 +92,7 @@ static void send_time_available(void)
 	TEST_ASSERT_EQUAL(0, err);
 }
 
-void send_trigger(void)
+static void send_trigger_once(void)
 {
 	enum trigger_type trigger_type = TRIGGER_DATA_SAMPLE;
 	int err = zbus_chan_pub(&TRIGGER_CHAN, &trigger_type, K_SECONDS(1));
@@ -59,16 +100,23 @@ void send_trigger(void)
 	TEST_ASSERT_EQUAL(0, err);
 }
 
-void wait_for_and_decode_payload(struct env_object *env_object)
+/* Send the triggers needed for a payload to be sent */
+void send_trigger(void)
+{
+	for (int i = 0; i < TRIGGERS_PER_PAYLOAD; i++) {
+		send_trigger_once();
+	}
+}
+
+static void wait_for_payload(struct payload *payload)
 {
 	const struct zbus_channel *chan;
-	static struct payload received_payload;
 	int err;
 
 	/* Allow the test thread to sleep so that the DUT's thread is allowed to run. */
 	k_sleep(K_MSEC(100));
 
-	err = zbus_sub_wait_msg(&transport, &chan, &received_payload, K_MSEC(1000));
+	err = zbus_sub_wait_msg(&transport, &chan, payload, K_MSEC(1000));
 	if (err == -ENOMSG) {
 		LOG_ERR("No payload message received");
 		TEST_FAIL();
@@ -84,39 +132,194 @@ void wait_for_and_decode_payload(struct env_object *env_object)
 		LOG_ERR("Received message from wrong channel");
 		TEST_FAIL();
 	}
+}
 
-	/* decode payload */
-	err = cbor_decode_env_object(received_payload.buffer,
-			       received_payload.buffer_len, env_object, NULL);
+static void wait_for_and_decode_aggregate_payload(struct env_aggregate_object *env_object)
+{
+	static struct payload received_payload;
+	int err;
+
+	wait_for_payload(&received_payload);
+
+	err = cbor_decode_env_aggregate_object(received_payload.buffer,
+					       received_payload.buffer_len, env_object, NULL);
 	if (err != ZCBOR_SUCCESS) {
 		LOG_ERR("Failed to decode payload");
 		TEST_FAIL();
 	}
 }
 
-void setUp(void)
+static void expect_no_payload(void)
 {
-	struct gas_sensor_dummy_data *data = sensor_dev->data;
-	memset(data, 0, sizeof(struct gas_sensor_dummy_data));
+	const struct zbus_channel *chan;
+	static struct payload received_payload;
+	int err;
 
-	/* reset fakes */
-	RESET_FAKE(task_wdt_feed);
-	RESET_FAKE(task_wdt_add);
-	RESET_FAKE(date_time_now);
+	k_sleep(K_MSEC(100));
 
-	date_time_now_fake.custom_fake = date_time_now_custom_fake;
-	send_time_available();
+	err = zbus_sub_wait_msg(&transport, &chan, &received_payload, K_MSEC(500));
+	TEST_ASSERT_EQUAL(-ENOMSG, err);
 }
 
-void tearDown(void)
+static void send_env_config(uint32_t temperature_deadband, uint32_t heartbeat)
+{
+	struct env_configuration config = {
+		.temperature = {
+			.absolute = temperature_deadband,
+			.absolute_present = true,
+		},
+		.heartbeat = heartbeat,
+		.heartbeat_present = true,
+	};
+	int err = zbus_chan_pub(&ENV_CONFIG_CHAN, &config, K_SECONDS(1));
+
+	TEST_ASSERT_EQUAL(0, err);
+}
+
+static void send_env_resources(uint32_t resources)
+{
+	struct env_configuration config = {
+		.resources = resources,
+		.resources_present = true,
+	};
+	int err = zbus_chan_pub(&ENV_CONFIG_CHAN, &config, K_SECONDS(1));
+
+	TEST_ASSERT_EQUAL(0, err);
+}
+
+#if defined(CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING)
+static void send_env_sample_interval(uint32_t min_sec, uint32_t max_sec)
+{
+	struct env_configuration config = {
+		.sample_interval_min = min_sec,
+		.sample_interval_min_present = true,
+		.sample_interval_max = max_sec,
+		.sample_interval_max_present = true,
+	};
+	int err = zbus_chan_pub(&ENV_CONFIG_CHAN, &config, K_SECONDS(1));
+
+	TEST_ASSERT_EQUAL(0, err);
+}
+
+/* The meeting room trace is replayed this many times faster than it was recorded, one minute
+ * of the trace every half second. The activity thresholds of the test scenario are scaled by
+ * the same factor.
+ */
+#define TRACE_SPEEDUP 120
+
+static struct gas_sensor_dummy_sample replay_trace[ARRAY_SIZE(gas_sensor_dummy_trace)];
+
+/* Local samples are counted from the events on the private channel of the module */
+static atomic_t local_samples;
+
+static void local_sample_counter_cb(const struct zbus_channel *chan)
+{
+	ARG_UNUSED(chan);
+
+	atomic_inc(&local_samples);
+}
+
+ZBUS_LISTENER_DEFINE(local_sample_counter, local_sample_counter_cb);
+ZBUS_CHAN_DECLARE(PRIV_ENVIRONMENTAL_CHAN);
+ZBUS_CHAN_ADD_OBS(PRIV_ENVIRONMENTAL_CHAN, local_sample_counter, 0);
+
+/* Replay the meeting room trace with the given bounds of the local sampling interval. The
+ * aggregates of the reporting period that spans the trace are decoded into env_object, and
+ * the number of local samples taken over it is returned.
+ */
+static uint32_t trace_replay_aggregate(uint32_t min_sec, uint32_t max_sec,
+				       struct env_aggregate_object *env_object)
+{
+	const uint32_t duration_ms = replay_trace[ARRAY_SIZE(replay_trace) - 1].time_ms;
+	int64_t end_ms;
+	int err;
+
+	for (size_t i = 0; i < ARRAY_SIZE(replay_trace); i++) {
+		replay_trace[i] = gas_sensor_dummy_trace[i];
+		replay_trace[i].time_ms /= TRACE_SPEEDUP;
+	}
+
+	send_env_sample_interval(min_sec, max_sec);
+	k_sleep(K_MSEC(100));
+
+	err = gas_sensor_dummy_trace_set(sensor_dev, replay_trace, ARRAY_SIZE(replay_trace));
+	TEST_ASSERT_EQUAL(0, err);
+
+	/* The reporting period starts with the trace, and ends just after its last step */
+	end_ms = k_uptime_get() + duration_ms + 250;
+
+	send_trigger();
+	wait_for_and_decode_aggregate_payload(env_object);
+	atomic_set(&local_samples, 0);
+
+	k_sleep(K_MSEC(end_ms - k_uptime_get()));
+
+	send_trigger();
+	wait_for_and_decode_aggregate_payload(env_object);
+
+	err = gas_sensor_dummy_trace_set(sensor_dev, NULL, 0);
+	TEST_ASSERT_EQUAL(0, err);
+
+	return (uint32_t)atomic_get(&local_samples);
+}
+#endif /* CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING */
+
+static void wait_for_and_decode_series_payload(struct env_series_object *env_object)
 {
-	const struct zbus_channel *chan;
 	static struct payload received_payload;
 	int err;
 
-	err = zbus_sub_wait_msg(&transport, &chan, &received_payload, K_MSEC(1000));
-	if (err == 0) {
-		LOG_ERR("Unhandled message in payload channel");
+	wait_for_payload(&received_payload);
+
+	err = cbor_decode_env_series_object(received_payload.buffer,
+					    received_payload.buffer_len, env_object, NULL);
+	if (err != ZCBOR_SUCCESS) {
+		LOG_ERR("Failed to decode payload");
+		TEST_FAIL();
+	}
+}
+
+void wait_for_and_decode_payload(struct env_object *env_object)
+{
+	static struct payload received_payload;
+	int err;
+
+	if (IS_ENABLED(CONFIG_APP_ENVIRONMENTAL_SERIES)) {
+		static struct env_series_object env_series_object;
+
+		/* The first sample of the series */
+		wait_for_and_decode_series_payload(&env_series_object);
+
+		env_object->temperature_m.bt.bt = env_series_object.series_temperature_m.bt;
+		env_object->temperature_m.vf = env_series_object.series_temperature_m.vf;
+		env_object->humidity_m.vf = env_series_object.series_humidity_m.vf;
+		env_object->pressure_m.vf = env_series_object.series_pressure_m.vf;
+		env_object->iaq_m.vi = env_series_object.series_iaq_m.vi;
+
+		return;
+	}
+
+	if (IS_ENABLED(CONFIG_APP_ENVIRONMENTAL_AGGREGATION)) {
+		static struct env_aggregate_object env_aggregate_object;
+
+		/* The last sample of the period is encoded like in the env object */
+		wait_for_and_decode_aggregate_payload(&env_aggregate_object);
+
+		env_object->temperature_m = env_aggregate_object.temperature_m;
+		env_object->humidity_m = env_aggregate_object.humidity_m;
+		env_object->pressure_m = env_aggregate_object.pressure_m;
+		env_object->iaq_m = env_aggregate_object.iaq_m;
+
+		return;
+	}
+
+	wait_for_payload(&received_payload);
+
+	/* decode payload */
+	err = cbor_decode_env_object(received_payload.buffer,
+			       received_payload.buffer_len, env_object, NULL);
+	if (err != ZCBOR_SUCCESS) {
+		LOG_ERR("Failed to decode payload");
 		TEST_FAIL();
 	}
 }
@@ -125,24 +328,184 @@ void set_temperature(float temperature)
 {
 	struct gas_sensor_dummy_data *data = sensor_dev->data;
 	data->temperature = temperature;
+
+	/* New results are signalled by the driver */
+	gas_sensor_dummy_data_ready(sensor_dev);
 }
 
 void set_pressure(float pressure)
 {
 	struct gas_sensor_dummy_data *data = sensor_dev->data;
 	data->pressure = pressure;
+
+	/* New results are signalled by the driver */
+	gas_sensor_dummy_data_ready(sensor_dev);
 }
 
 void set_humidity(float humidity)
 {
 	struct gas_sensor_dummy_data *data = sensor_dev->data;
 	data->humidity = humidity;
+
+	/* New results are signalled by the driver */
+	gas_sensor_dummy_data_ready(sensor_dev);
 }
 
 void set_iaq(int iaq)
 {
 	struct gas_sensor_dummy_data *data = sensor_dev->data;
 	data->iaq = iaq;
+
+	/* New results are signalled by the driver */
+	gas_sensor_dummy_data_ready(sensor_dev);
+}
+
+void set_co2(int co2)
+{
+	struct gas_sensor_dummy_data *data = sensor_dev->data;
+	data->co2 = co2;
+
+	/* New results are signalled by the driver */
+	gas_sensor_dummy_data_ready(sensor_dev);
+}
+
+void set_voc(float voc)
+{
+	struct gas_sensor_dummy_data *data = sensor_dev->data;
+	data->voc = voc;
+
+	/* New results are signalled by the driver */
+	gas_sensor_dummy_data_ready(sensor_dev);
+}
+
+/* The module only waits for time once after boot. Samples are therefore triggered before time
+ * is available here, before any test has made it available, and the payload that is sent
+ * once it is available is checked by test_samples_before_time().
+ */
+void suiteSetUp(void)
+{
+	const struct zbus_channel *chan;
+	enum trigger_type trigger_type = TRIGGER_DATA_SAMPLE;
+	enum time_status time_status = TIME_AVAILABLE;
+
+	date_time_now_fake.custom_fake = date_time_now_custom_fake;
+	date_time_uptime_to_unix_time_ms_fake.custom_fake =
+		date_time_uptime_to_unix_time_ms_custom_fake;
+
+	set_temperature(20.0);
+
+	for (int i = 0; i < TRIGGERS_PER_PAYLOAD; i++) {
+		(void)zbus_chan_pub(&TRIGGER_CHAN, &trigger_type, K_SECONDS(1));
+	}
+
+	before_time_early = (zbus_sub_wait_msg(&transport, &chan, &before_time_payload,
+					       K_MSEC(500)) == 0);
+
+	(void)zbus_chan_pub(&TIME_CHAN, &time_status, K_SECONDS(1));
+
+	/* With aggregation, the samples are part of the first reporting period */
+	if (IS_ENABLED(CONFIG_APP_ENVIRONMENTAL_AGGREGATION)) {
+		before_time_early |= (zbus_sub_wait_msg(&transport, &chan, &before_time_payload,
+							K_MSEC(500)) == 0);
+
+		set_temperature(30.0);
+		(void)zbus_chan_pub(&TRIGGER_CHAN, &trigger_type, K_SECONDS(1));
+	}
+
+	before_time_err = zbus_sub_wait_msg(&transport, &chan, &before_time_payload,
+					    K_MSEC(1000));
+	before_time_conversions = date_time_uptime_to_unix_time_ms_fake.call_count;
+	before_time_now_calls = date_time_now_fake.call_count;
+}
+
+void setUp(void)
+{
+	set_temperature(0);
+	set_pressure(0);
+	set_humidity(0);
+	set_iaq(0);
+	set_co2(0);
+	set_voc(0);
+
+	/* reset fakes */
+	RESET_FAKE(supervisor_checkin);
+	RESET_FAKE(supervisor_checkout);
+	RESET_FAKE(date_time_now);
+	RESET_FAKE(date_time_uptime_to_unix_time_ms);
+
+	date_time_now_fake.custom_fake = date_time_now_custom_fake;
+	date_time_uptime_to_unix_time_ms_fake.custom_fake =
+		date_time_uptime_to_unix_time_ms_custom_fake;
+
+	send_time_available();
+}
+
+void tearDown(void)
+{
+	const struct zbus_channel *chan;
+	static struct payload received_payload;
+	int err;
+
+	err = zbus_sub_wait_msg(&transport, &chan, &received_payload, K_MSEC(1000));
+	if (err == 0) {
+		LOG_ERR("Unhandled message in payload channel");
+		TEST_FAIL();
+	}
+}
+
+void test_samples_before_time(void)
+{
+	int err;
+	int32_t timestamp;
+	float temperature;
+
+	/* Given
+	 * Samples triggered before time is available, in suiteSetUp()
+	 */
+	TEST_ASSERT_FALSE_MESSAGE(before_time_early, "Payload sent before time was available");
+
+	/* Then
+	 * The samples are sent once time is available, timestamped from their uptime. With
+	 * aggregation, they are part of the first reporting period.
+	 */
+	TEST_ASSERT_EQUAL(0, before_time_err);
+
+	if (IS_ENABLED(CONFIG_APP_ENVIRONMENTAL_AGGREGATION)) {
+		static struct env_aggregate_object env_aggregate_object = {0};
+
+		err = cbor_decode_env_aggregate_object(before_time_payload.buffer,
+						       before_time_payload.buffer_len,
+						       &env_aggregate_object, NULL);
+		TEST_ASSERT_EQUAL(ZCBOR_SUCCESS, err);
+
+		TEST_ASSERT_EQUAL_FLOAT(20.0, env_aggregate_object.min_temperature_m.vf);
+		TEST_ASSERT_EQUAL_FLOAT(30.0, env_aggregate_object.max_temperature_m.vf);
+		return;
+	}
+
+	if (IS_ENABLED(CONFIG_APP_ENVIRONMENTAL_SERIES)) {
+		static struct env_series_object env_series_object = {0};
+
+		err = cbor_decode_env_series_object(before_time_payload.buffer,
+						    before_time_payload.buffer_len,
+						    &env_series_object, NULL);
+		timestamp = env_series_object.series_temperature_m.bt;
+		temperature = env_series_object.series_temperature_m.vf;
+	} else {
+		static struct env_object env_object = {0};
+
+		err = cbor_decode_env_object(before_time_payload.buffer,
+					     before_time_payload.buffer_len, &env_object, NULL);
+		timestamp = env_object.temperature_m.bt.bt;
+		temperature = env_object.temperature_m.vf;
+	}
+
+	TEST_ASSERT_EQUAL(ZCBOR_SUCCESS, err);
+	TEST_ASSERT_EQUAL_FLOAT(20.0, temperature);
+	TEST_ASSERT_LESS_OR_EQUAL(FAKE_TIME_MS / 1000, timestamp);
+	TEST_ASSERT_GREATER_THAN(FAKE_TIME_MS / 1000 - 2, timestamp);
+	TEST_ASSERT_EQUAL(TRIGGERS_PER_PAYLOAD, before_time_conversions);
+	TEST_ASSERT_EQUAL(0, before_time_now_calls);
 }
 
 void test_only_timestamp(void)
@@ -218,13 +581,593 @@ void test_iaq(void)
 	TEST_ASSERT_EQUAL_INT_MESSAGE(SENSOR_IAQ, env_object.iaq_m.vi, "iaq");
 }
 
-void test_no_events_on_zbus_until_watchdog_timeout(void)
+void test_co2_voc(void)
 {
-	/* Wait without feeding any events to zbus until watch dog timeout. */
-	k_sleep(K_SECONDS(CONFIG_APP_ENVIRONMENTAL_WATCHDOG_TIMEOUT_SECONDS));
+	static struct env_object env_object = {0};
+
+	if (!IS_ENABLED(CONFIG_APP_ENVIRONMENTAL_REPORT_SINGLE)) {
+		TEST_IGNORE_MESSAGE("CO2 and VOC are only sent in single sample reports");
+	}
+
+	/* Given */
+	set_co2(SENSOR_CO2);
+	set_voc(SENSOR_VOC);
+
+	/* When */
+	send_trigger();
+	wait_for_and_decode_payload(&env_object);
 
-	/* Check if the watchdog was fed atleast once.*/
-	TEST_ASSERT_GREATER_OR_EQUAL(1, task_wdt_feed_fake.call_count);
+	/* Then
+	 * All resources are sent by default, the base name and time with the first record
+	 */
+	TEST_ASSERT_TRUE(env_object.temperature_m_present);
+	TEST_ASSERT_TRUE(env_object.temperature_m.bn_present);
+	TEST_ASSERT_TRUE(env_object.temperature_m.bt_present);
+	TEST_ASSERT_EQUAL(FAKE_TIME_MS / 1000, env_object.temperature_m.bt.bt);
+	TEST_ASSERT_TRUE(env_object.co2_m_present);
+	TEST_ASSERT_FALSE(env_object.co2_m.bn_present);
+	TEST_ASSERT_EQUAL_INT_MESSAGE(SENSOR_CO2, env_object.co2_m.vi, "co2");
+	TEST_ASSERT_TRUE(env_object.voc_m_present);
+	TEST_ASSERT_EQUAL_INT_MESSAGE(SENSOR_VOC * 1000, env_object.voc_m.vi, "voc");
+}
+
+void test_resources(void)
+{
+	static struct env_object env_object = {0};
+
+	if (!IS_ENABLED(CONFIG_APP_ENVIRONMENTAL_REPORT_SINGLE)) {
+		TEST_IGNORE_MESSAGE("The resources mask only applies to single sample reports");
+	}
+
+	/* Given
+	 * Only CO2 and VOC are enabled
+	 */
+	send_env_resources(ENV_RESOURCE_CO2 | ENV_RESOURCE_VOC);
+	set_co2(SENSOR_CO2);
+
+	/* When */
+	send_trigger();
+	wait_for_and_decode_payload(&env_object);
+
+	/* Then
+	 * The base name and time are sent with the CO2 record
+	 */
+	TEST_ASSERT_FALSE(env_object.temperature_m_present);
+	TEST_ASSERT_FALSE(env_object.humidity_m_present);
+	TEST_ASSERT_FALSE(env_object.pressure_m_present);
+	TEST_ASSERT_FALSE(env_object.iaq_m_present);
+	TEST_ASSERT_TRUE(env_object.co2_m_present);
+	TEST_ASSERT_TRUE(env_object.co2_m.bn_present);
+	TEST_ASSERT_TRUE(env_object.co2_m.bt_present);
+	TEST_ASSERT_EQUAL(FAKE_TIME_MS / 1000, env_object.co2_m.bt.bt);
+	TEST_ASSERT_EQUAL_INT_MESSAGE(SENSOR_CO2, env_object.co2_m.vi, "co2");
+	TEST_ASSERT_TRUE(env_object.voc_m_present);
+	TEST_ASSERT_FALSE(env_object.voc_m.bn_present);
+
+	/* When
+	 * No resource is enabled
+	 */
+	send_env_resources(0);
+	send_trigger();
+
+	/* Then */
+	expect_no_payload();
+
+	send_env_resources(CONFIG_APP_ENVIRONMENTAL_RESOURCES);
+}
+
+void test_fixed_point(void)
+{
+	static struct env_object env_object = {0};
+
+	/* Given
+	 * Values that are not exact in binary floating point, the sensor reports them with an
+	 * error in the last micro unit
+	 */
+	set_temperature(-5.37);
+	set_humidity(45.67);
+	set_pressure(101325.4);
+
+	/* When */
+	send_trigger();
+	wait_for_and_decode_payload(&env_object);
+
+	/* Then
+	 * The values are rounded to two decimals
+	 */
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(-5.37f, env_object.temperature_m.vf, "temperature");
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(45.67f, env_object.humidity_m.vf, "humidity");
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(1013.25f, env_object.pressure_m.vf, "pressure");
+}
+
+void test_snapshot(void)
+{
+	static struct env_object env_object = {0};
+	struct gas_sensor_dummy_data *data = sensor_dev->data;
+	struct env_snapshot snapshot;
+	int err;
+
+	if (IS_ENABLED(CONFIG_APP_ENVIRONMENTAL_SENSOR_PM)) {
+		TEST_IGNORE_MESSAGE("The sensor is suspended between samples");
+	}
+
+	/* Given
+	 * The driver has signalled new results, and the sensor values change afterwards
+	 */
+	set_temperature(30.0);
+	data->temperature = 40.0;
+
+	err = env_snapshot_get(&snapshot);
+	TEST_ASSERT_EQUAL(0, err);
+	TEST_ASSERT_EQUAL(3000, snapshot.sample.temperature);
+
+	/* When */
+	send_trigger();
+	wait_for_and_decode_payload(&env_object);
+
+	/* Then
+	 * The sample is taken from the snapshot
+	 */
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(30.0, env_object.temperature_m.vf, "temperature");
+
+	/* When
+	 * The driver does not signal new results for longer than the maximum snapshot age
+	 */
+	k_sleep(K_SECONDS(CONFIG_APP_ENVIRONMENTAL_SNAPSHOT_AGE_MAX_SECONDS + 1));
+
+	send_trigger();
+	wait_for_and_decode_payload(&env_object);
+
+	/* Then
+	 * The sensor is read
+	 */
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(40.0, env_object.temperature_m.vf, "temperature");
+}
+
+void test_sensor_pm(void)
+{
+#if defined(CONFIG_APP_ENVIRONMENTAL_SENSOR_PM)
+	static struct env_object env_object = {0};
+	struct env_snapshot snapshot;
+	enum pm_device_state state;
+	int err;
+
+	/* Given
+	 * The sensor is suspended between samples
+	 */
+	err = pm_device_state_get(sensor_dev, &state);
+	TEST_ASSERT_EQUAL(0, err);
+	TEST_ASSERT_EQUAL(PM_DEVICE_STATE_SUSPENDED, state);
+
+	/* When */
+	set_temperature(23.0);
+	send_trigger();
+	wait_for_and_decode_payload(&env_object);
+
+	/* Then
+	 * The sensor is resumed for the sample and suspended again, the warm-up time is
+	 * reported as added latency
+	 */
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(23.0, env_object.temperature_m.vf, "temperature");
+
+	err = pm_device_state_get(sensor_dev, &state);
+	TEST_ASSERT_EQUAL(0, err);
+	TEST_ASSERT_EQUAL(PM_DEVICE_STATE_SUSPENDED, state);
+
+	err = env_snapshot_get(&snapshot);
+	TEST_ASSERT_EQUAL(0, err);
+	TEST_ASSERT_GREATER_OR_EQUAL(CONFIG_APP_ENVIRONMENTAL_SENSOR_WARMUP_MS,
+				     snapshot.latency_ms);
+#else
+	TEST_IGNORE_MESSAGE("Sensor power management is not enabled");
+#endif /* CONFIG_APP_ENVIRONMENTAL_SENSOR_PM */
+}
+
+void test_trace_replay(void)
+{
+	static const struct gas_sensor_dummy_sample trace[] = {
+		{ .time_ms = 0, .temperature = 20.0f, .iaq = 50, .co2 = 500, .voc = 0.5f },
+		{ .time_ms = 500, .temperature = 21.0f, .iaq = 60, .co2 = 600, .voc = 1.0f },
+		{ .time_ms = 1000, .temperature = 22.0f, .iaq = 70, .co2 = 700, .voc = 1.5f },
+	};
+	static const struct gas_sensor_dummy_sample unordered[] = {
+		{ .time_ms = 500 },
+		{ .time_ms = 500 },
+	};
+	struct env_snapshot snapshot;
+	int err;
+
+	if (IS_ENABLED(CONFIG_APP_ENVIRONMENTAL_SENSOR_PM)) {
+		TEST_IGNORE_MESSAGE("The sensor is suspended between samples");
+	}
+
+	err = gas_sensor_dummy_trace_set(sensor_dev, unordered, ARRAY_SIZE(unordered));
+	TEST_ASSERT_EQUAL(-EINVAL, err);
+
+	/* When */
+	err = gas_sensor_dummy_trace_set(sensor_dev, trace, ARRAY_SIZE(trace));
+	TEST_ASSERT_EQUAL(0, err);
+
+	/* Then
+	 * Each step is applied at its time and signalled as new results, the trace restarts
+	 * one step after its last step
+	 */
+	k_sleep(K_MSEC(250));
+
+	for (int i = 0; i < ARRAY_SIZE(trace) + 1; i++) {
+		const struct gas_sensor_dummy_sample *step = &trace[i % ARRAY_SIZE(trace)];
+
+		err = env_snapshot_get(&snapshot);
+		TEST_ASSERT_EQUAL(0, err);
+		TEST_ASSERT_EQUAL(step->temperature * 100, snapshot.sample.temperature);
+		TEST_ASSERT_EQUAL(step->iaq, snapshot.sample.iaq);
+		TEST_ASSERT_EQUAL(step->co2, snapshot.sample.co2);
+		TEST_ASSERT_EQUAL(step->voc * 1000, snapshot.sample.voc);
+
+		k_sleep(K_MSEC(500));
+	}
+
+	err = gas_sensor_dummy_trace_set(sensor_dev, NULL, 0);
+	TEST_ASSERT_EQUAL(0, err);
+}
+
+void test_deadband(void)
+{
+	static struct env_object env_object = {0};
+
+	if (IS_ENABLED(CONFIG_APP_ENVIRONMENTAL_SERIES)) {
+		TEST_IGNORE_MESSAGE("Samples within deadbands are not added to the series");
+	}
+
+	/* Given
+	 * A 0.5 degree temperature deadband and a sample sent every third interval regardless
+	 */
+	send_env_config(50, 3);
+
+	set_temperature(21.0);
+	send_trigger();
+	wait_for_and_decode_payload(&env_object);
+
+	/* When
+	 * The temperature does not change by more than the deadband
+	 */
+	send_trigger();
+	expect_no_payload();
+
+	set_temperature(21.4);
+	send_trigger();
+	expect_no_payload();
+
+	/* Then
+	 * The third interval is sent as a heartbeat
+	 */
+	send_trigger();
+	wait_for_and_decode_payload(&env_object);
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(21.4, env_object.temperature_m.vf, "temperature");
+
+	/* And a change larger than the deadband is sent */
+	set_temperature(22.0);
+	send_trigger();
+	wait_for_and_decode_payload(&env_object);
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(22.0, env_object.temperature_m.vf, "temperature");
+
+	send_env_config(0, CONFIG_APP_ENVIRONMENTAL_HEARTBEAT_INTERVALS);
+}
+
+void test_deadband_co2_voc(void)
+{
+	static struct env_object env_object = {0};
+
+	if (!IS_ENABLED(CONFIG_APP_ENVIRONMENTAL_REPORT_SINGLE)) {
+		TEST_IGNORE_MESSAGE("CO2 and VOC are only sent in single sample reports");
+	}
+
+	/* Given
+	 * Only CO2 and VOC are enabled, and a temperature deadband is set
+	 */
+	send_env_resources(ENV_RESOURCE_CO2 | ENV_RESOURCE_VOC);
+	send_env_config(50, CONFIG_APP_ENVIRONMENTAL_HEARTBEAT_INTERVALS);
+
+	set_co2(777);
+	send_trigger();
+	wait_for_and_decode_payload(&env_object);
+
+	/* When
+	 * CO2 and VOC do not change
+	 */
+	send_trigger();
+
+	/* Then */
+	expect_no_payload();
+
+	/* When
+	 * CO2 changes, which has no deadband
+	 */
+	set_co2(800);
+	send_trigger();
+
+	/* Then */
+	wait_for_and_decode_payload(&env_object);
+	TEST_ASSERT_EQUAL_INT_MESSAGE(800, env_object.co2_m.vi, "co2");
+
+	send_env_config(0, CONFIG_APP_ENVIRONMENTAL_HEARTBEAT_INTERVALS);
+	send_env_resources(CONFIG_APP_ENVIRONMENTAL_RESOURCES);
+}
+
+void test_aggregates(void)
+{
+	static struct env_aggregate_object env_object = {0};
+
+	if (!IS_ENABLED(CONFIG_APP_ENVIRONMENTAL_AGGREGATION)) {
+		TEST_IGNORE_MESSAGE("Aggregation is not enabled");
+	}
+
+	if (IS_ENABLED(CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING)) {
+		TEST_IGNORE_MESSAGE("The local sampling interval is adaptive");
+	}
+
+	/* Given
+	 * A reporting period that starts now, with one local sample taken after one second
+	 */
+	send_trigger();
+	wait_for_and_decode_aggregate_payload(&env_object);
+
+	set_temperature(20.0);
+	set_humidity(40.0);
+	set_pressure(100000.0);
+	set_iaq(50);
+	k_sleep(K_MSEC(1500));
+
+	set_temperature(30.0);
+	set_humidity(50.0);
+	set_pressure(100200.0);
+	set_iaq(101);
+
+	/* When */
+	send_trigger();
+	wait_for_and_decode_aggregate_payload(&env_object);
+
+	/* Then */
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(30.0, env_object.temperature_m.vf, "last temperature");
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(20.0, env_object.min_temperature_m.vf, "min temperature");
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(30.0, env_object.max_temperature_m.vf, "max temperature");
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(25.0, env_object.mean_temperature_m.vf, "mean temperature");
+	TEST_ASSERT_EQUAL_INT_MESSAGE(101, env_object.iaq_m.vi, "last iaq");
+	TEST_ASSERT_EQUAL_INT_MESSAGE(50, env_object.min_iaq_m.vi, "min iaq");
+	TEST_ASSERT_EQUAL_INT_MESSAGE(101, env_object.max_iaq_m.vi, "max iaq");
+	TEST_ASSERT_EQUAL_INT_MESSAGE(76, env_object.mean_iaq_m.vi, "mean iaq");
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(5.0, env_object.stddev_temperature_m.vf,
+					"stddev temperature");
+	TEST_ASSERT_EQUAL_INT_MESSAGE(26, env_object.stddev_iaq_m.vi, "stddev iaq");
+
+	/* Pressure and humidity are aggregated as deviations from the first sample */
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(1001.0, env_object.mean_pressure_m.vf, "mean pressure");
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(1.0, env_object.stddev_pressure_m.vf, "stddev pressure");
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(45.0, env_object.mean_humidity_m.vf, "mean humidity");
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(5.0, env_object.stddev_humidity_m.vf, "stddev humidity");
+}
+
+void test_aggregates_measured_once(void)
+{
+	static struct env_aggregate_object env_object = {0};
+
+	if (!IS_ENABLED(CONFIG_APP_ENVIRONMENTAL_AGGREGATION)) {
+		TEST_IGNORE_MESSAGE("Aggregation is not enabled");
+	}
+
+	if (IS_ENABLED(CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING)) {
+		TEST_IGNORE_MESSAGE("The local sampling interval is adaptive");
+	}
+
+	/* Given
+	 * A reporting period with local samples taken after one and two seconds, each of a new
+	 * measurement
+	 */
+	send_trigger();
+	wait_for_and_decode_aggregate_payload(&env_object);
+
+	set_temperature(20.0);
+	k_sleep(K_MSEC(1500));
+
+	set_temperature(30.0);
+	k_sleep(K_MSEC(700));
+
+	/* When
+	 * The data sample trigger comes before the driver has measured again
+	 */
+	send_trigger();
+	wait_for_and_decode_aggregate_payload(&env_object);
+
+	/* Then
+	 * The last measurement is only aggregated once
+	 */
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(30.0, env_object.temperature_m.vf, "last temperature");
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(25.0, env_object.mean_temperature_m.vf, "mean temperature");
+	TEST_ASSERT_EQUAL_FLOAT_MESSAGE(5.0, env_object.stddev_temperature_m.vf,
+					"stddev temperature");
+}
+
+void test_adaptive_sampling(void)
+{
+#if defined(CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING)
+	const uint32_t interval_max = CONFIG_APP_ENVIRONMENTAL_AGGREGATION_SAMPLE_INTERVAL_SECONDS;
+
+	/* Given
+	 * Flat values, the local sampling interval backs off to the longest interval
+	 */
+	set_temperature(20.0);
+
+	for (int i = 0; i < 20 && env_local_sample_interval_get() < interval_max; i++) {
+		k_sleep(K_SECONDS(1));
+	}
+
+	TEST_ASSERT_EQUAL(interval_max, env_local_sample_interval_get());
+
+	/* When */
+	set_temperature(25.0);
+	k_sleep(K_SECONDS(interval_max + 1));
+
+	/* Then */
+	TEST_ASSERT_LESS_THAN(interval_max, env_local_sample_interval_get());
+#else
+	TEST_IGNORE_MESSAGE("Adaptive sampling is not enabled");
+#endif /* CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING */
+}
+
+void test_adaptive_sampling_bounds(void)
+{
+#if defined(CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING)
+	const uint32_t interval_min = CONFIG_APP_ENVIRONMENTAL_AGGREGATION_SAMPLE_INTERVAL_MIN_SECONDS;
+	const uint32_t interval_max = CONFIG_APP_ENVIRONMENTAL_AGGREGATION_SAMPLE_INTERVAL_SECONDS;
+
+	/* Given
+	 * Flat values, the local sampling interval backs off to the longest interval
+	 */
+	set_temperature(20.0);
+
+	for (int i = 0; i < 20 && env_local_sample_interval_get() < interval_max; i++) {
+		k_sleep(K_SECONDS(1));
+	}
+
+	TEST_ASSERT_EQUAL(interval_max, env_local_sample_interval_get());
+
+	/* When
+	 * A shorter longest interval is configured
+	 */
+	send_env_sample_interval(interval_min, interval_max / 2);
+	k_sleep(K_MSEC(100));
+
+	/* Then
+	 * It is used right away, and kept while values are flat
+	 */
+	TEST_ASSERT_EQUAL(interval_max / 2, env_local_sample_interval_get());
+	k_sleep(K_SECONDS(interval_max + 1));
+	TEST_ASSERT_EQUAL(interval_max / 2, env_local_sample_interval_get());
+
+	/* When
+	 * Bounds with the shortest interval above the longest are configured
+	 */
+	send_env_sample_interval(interval_max, interval_min);
+	k_sleep(K_MSEC(100));
+
+	/* Then
+	 * They are ignored
+	 */
+	TEST_ASSERT_EQUAL(interval_max / 2, env_local_sample_interval_get());
+
+	send_env_sample_interval(interval_min, interval_max);
+	k_sleep(K_MSEC(100));
+#else
+	TEST_IGNORE_MESSAGE("Adaptive sampling is not enabled");
+#endif /* CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING */
+}
+
+void test_adaptive_sampling_trace(void)
+{
+#if defined(CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING)
+	static struct env_aggregate_object fixed = {0};
+	static struct env_aggregate_object adaptive = {0};
+	const uint32_t interval_min = CONFIG_APP_ENVIRONMENTAL_AGGREGATION_SAMPLE_INTERVAL_MIN_SECONDS;
+	const uint32_t interval_max = CONFIG_APP_ENVIRONMENTAL_AGGREGATION_SAMPLE_INTERVAL_SECONDS;
+	uint32_t fixed_count;
+	uint32_t adaptive_count;
+
+	/* Given
+	 * The meeting room trace sampled at the fixed shortest interval
+	 */
+	fixed_count = trace_replay_aggregate(interval_min, interval_min, &fixed);
+
+	/* When
+	 * It is sampled with the adaptive interval
+	 */
+	adaptive_count = trace_replay_aggregate(interval_min, interval_max, &adaptive);
+
+	/* Then
+	 * Less than half the samples are taken, and the extremes stay within about one minute
+	 * of change at the default activity thresholds of the fixed rate extremes
+	 */
+	LOG_INF("Local samples, fixed: %u, adaptive: %u", fixed_count, adaptive_count);
+
+	TEST_ASSERT_GREATER_THAN(0, adaptive_count);
+	TEST_ASSERT_LESS_THAN(fixed_count / 2, adaptive_count);
+
+	TEST_ASSERT_FLOAT_WITHIN(0.1, fixed.min_temperature_m.vf, adaptive.min_temperature_m.vf);
+	TEST_ASSERT_FLOAT_WITHIN(0.1, fixed.max_temperature_m.vf, adaptive.max_temperature_m.vf);
+	TEST_ASSERT_FLOAT_WITHIN(0.5, fixed.min_humidity_m.vf, adaptive.min_humidity_m.vf);
+	TEST_ASSERT_FLOAT_WITHIN(0.5, fixed.max_humidity_m.vf, adaptive.max_humidity_m.vf);
+	TEST_ASSERT_FLOAT_WITHIN(0.2, fixed.min_pressure_m.vf, adaptive.min_pressure_m.vf);
+	TEST_ASSERT_FLOAT_WITHIN(0.2, fixed.max_pressure_m.vf, adaptive.max_pressure_m.vf);
+	TEST_ASSERT_INT_WITHIN(5, fixed.min_iaq_m.vi, adaptive.min_iaq_m.vi);
+	TEST_ASSERT_INT_WITHIN(5, fixed.max_iaq_m.vi, adaptive.max_iaq_m.vi);
+#else
+	TEST_IGNORE_MESSAGE("Adaptive sampling is not enabled");
+#endif /* CONFIG_APP_ENVIRONMENTAL_ADAPTIVE_SAMPLING */
+}
+
+void test_series(void)
+{
+	static struct env_series_object env_object = {0};
+
+	if (!IS_ENABLED(CONFIG_APP_ENVIRONMENTAL_SERIES)) {
+		TEST_IGNORE_MESSAGE("Series are not enabled");
+	}
+
+	/* Given
+	 * Samples taken a minute apart
+	 */
+	fake_time_ms = FAKE_TIME_MS;
+	date_time_now_fake.custom_fake = date_time_now_advancing_custom_fake;
+
+	/* When */
+	for (int i = 0; i < TRIGGERS_PER_PAYLOAD; i++) {
+		set_temperature(20.0 + i);
+		set_iaq(50 + i);
+		send_trigger_once();
+		k_sleep(K_MSEC(100));
+	}
+
+	wait_for_and_decode_series_payload(&env_object);
+
+	/* Then
+	 * The first sample is sent with the base time, the others with their offsets
+	 */
+	TEST_ASSERT_EQUAL(FAKE_TIME_MS / 1000, env_object.series_temperature_m.bt);
+	TEST_ASSERT_EQUAL_FLOAT(20.0, env_object.series_temperature_m.vf);
+	TEST_ASSERT_EQUAL(50, env_object.series_iaq_m.vi);
+	TEST_ASSERT_EQUAL(TRIGGERS_PER_PAYLOAD - 1, env_object.series_temperature_value_m_count);
+	TEST_ASSERT_EQUAL(TRIGGERS_PER_PAYLOAD - 1, env_object.series_iaq_value_m_count);
+
+	for (int i = 1; i < TRIGGERS_PER_PAYLOAD; i++) {
+		int32_t offset = i * SERIES_INTERVAL_MS / MSEC_PER_SEC;
+
+		TEST_ASSERT_EQUAL_FLOAT(20.0 + i, env_object.series_temperature_value_m[i - 1].vf);
+		TEST_ASSERT_EQUAL(offset, env_object.series_temperature_value_m[i - 1].t);
+		TEST_ASSERT_EQUAL(50 + i, env_object.series_iaq_value_m[i - 1].vi);
+		TEST_ASSERT_EQUAL(offset, env_object.series_iaq_value_m[i - 1].t);
+	}
+}
+
+void test_no_wakeups_without_events_on_zbus(void)
+{
+	unsigned int checkins;
+
+	if (IS_ENABLED(CONFIG_APP_ENVIRONMENTAL_AGGREGATION)) {
+		TEST_IGNORE_MESSAGE("Local samples wake up the module");
+	}
+
+	/* Let the module handle the events sent during setup */
+	k_sleep(K_MSEC(100));
+
+	checkins = supervisor_checkin_fake.call_count;
+
+	/* Wait without feeding any events to zbus for longer than the supervisor timeout. */
+	k_sleep(K_SECONDS(CONFIG_APP_ENVIRONMENTAL_WATCHDOG_TIMEOUT_SECONDS * 2));
+
+	/* The module thread must not have woken up, and must have checked out of the
+	 * events it processed.
+	 */
+	TEST_ASSERT_EQUAL(checkins, supervisor_checkin_fake.call_count);
+	TEST_ASSERT_EQUAL(supervisor_checkin_fake.call_count, supervisor_checkout_fake.call_count);
 }
 
 /* This is required to be added to each test. That is because unity's
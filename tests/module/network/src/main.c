@@ -7,13 +7,13 @@
 
 #include <zephyr/fff.h>
 #include <zephyr/zbus/zbus.h>
-#include <zephyr/task_wdt/task_wdt.h>
 #include <zephyr/logging/log.h>
 #include "modem/lte_lc.h"
 #include "modem/modem_info.h"
 #include "zephyr/net/net_mgmt.h"
 
 #include "message_channel.h"
+#include "supervisor.h"
 
 #include "zcbor_decode.h"
 #include "conn_info_object_decode.h"
@@ -21,8 +21,10 @@
 DEFINE_FFF_GLOBALS;
 
 FAKE_VALUE_FUNC(int, date_time_now, int64_t *);
-FAKE_VALUE_FUNC(int, task_wdt_feed, int);
-FAKE_VALUE_FUNC(int, task_wdt_add, uint32_t, task_wdt_callback_t, void *);
+FAKE_VALUE_FUNC(int, date_time_uptime_to_unix_time_ms, int64_t *);
+FAKE_VALUE_FUNC(int, supervisor_add, const struct zbus_observer *, uint32_t);
+FAKE_VOID_FUNC(supervisor_checkin, int);
+FAKE_VOID_FUNC(supervisor_checkout, int);
 FAKE_VALUE_FUNC(int, lte_lc_conn_eval_params_get, struct lte_lc_conn_eval_params *);
 FAKE_VALUE_FUNC(int, conn_mgr_all_if_connect, bool);
 FAKE_VALUE_FUNC(int, conn_mgr_all_if_disconnect, bool);
@@ -43,12 +45,29 @@ ZBUS_CHAN_ADD_OBS(PAYLOAD_CHAN, test_subscriber, 0);
 #define FAKE_ENERGY_ESTIMATE 7
 #define FAKE_ENERGY_ESTIMATE_MIN 5
 
+/* Samples triggered before time is available in suiteSetUp(), and the time between them */
+#define SAMPLES_BEFORE_TIME 2
+#define SAMPLES_BEFORE_TIME_INTERVAL_MS 2000
+
+/* Payloads sent for the samples triggered before time is available */
+static struct payload before_time_payloads[SAMPLES_BEFORE_TIME];
+static size_t before_time_payload_count;
+static bool before_time_early;
+static unsigned int before_time_conversions;
+
 static int date_time_now_custom_fake(int64_t *time)
 {
 	*time = FAKE_TIME_MS;
 	return 0;
 }
 
+/* Uptimes are converted relative to the current time, FAKE_TIME_MS */
+static int date_time_uptime_to_unix_time_ms_custom_fake(int64_t *uptime)
+{
+	*uptime = FAKE_TIME_MS - (k_uptime_get() - *uptime);
+	return 0;
+}
+
 static int lte_lc_conn_eval_params_get_custom_fake(struct lte_lc_conn_eval_params *params)
 {
 	params->energy_estimate = FAKE_ENERGY_ESTIMATE;
@@ -139,10 +158,45 @@ static void wait_for_and_decode_payload(struct conn_info_object *conn_info_obj)
 	}
 }
 
+/* The module only waits for time once after boot. Samples are therefore triggered before time
+ * is available here, before any test has made it available, and the payloads that are sent
+ * once it is available are checked by test_samples_before_time().
+ */
+void suiteSetUp(void)
+{
+	const struct zbus_channel *chan;
+	enum trigger_type trigger_type = TRIGGER_DATA_SAMPLE;
+	enum time_status time_status = TIME_AVAILABLE;
+	struct payload payload;
+
+	lte_lc_conn_eval_params_get_fake.custom_fake = lte_lc_conn_eval_params_get_custom_fake;
+	date_time_uptime_to_unix_time_ms_fake.custom_fake =
+		date_time_uptime_to_unix_time_ms_custom_fake;
+
+	for (int i = 0; i < SAMPLES_BEFORE_TIME; i++) {
+		(void)zbus_chan_pub(&TRIGGER_CHAN, &trigger_type, K_SECONDS(1));
+		k_sleep(K_MSEC(SAMPLES_BEFORE_TIME_INTERVAL_MS));
+	}
+
+	before_time_early = (zbus_sub_wait_msg(&test_subscriber, &chan, &payload,
+					       K_NO_WAIT) == 0);
+
+	(void)zbus_chan_pub(&TIME_CHAN, &time_status, K_SECONDS(1));
+
+	while ((before_time_payload_count < SAMPLES_BEFORE_TIME) &&
+	       (zbus_sub_wait_msg(&test_subscriber, &chan,
+				  &before_time_payloads[before_time_payload_count],
+				  K_MSEC(1000)) == 0)) {
+		before_time_payload_count++;
+	}
+
+	before_time_conversions = date_time_uptime_to_unix_time_ms_fake.call_count;
+}
+
 void setUp(void)
 {
-	RESET_FAKE(task_wdt_feed);
-	RESET_FAKE(task_wdt_add);
+	RESET_FAKE(supervisor_checkin);
+	RESET_FAKE(supervisor_checkout);
 	RESET_FAKE(date_time_now);
 	RESET_FAKE(lte_lc_conn_eval_params_get);
 	RESET_FAKE(conn_mgr_all_if_connect);
@@ -166,6 +220,37 @@ void tearDown(void)
 	}
 }
 
+void test_samples_before_time(void)
+{
+	int err;
+	static struct conn_info_object conn_info_obj[SAMPLES_BEFORE_TIME];
+
+	/* Given
+	 * Samples triggered before time is available, in suiteSetUp()
+	 */
+	TEST_ASSERT_FALSE_MESSAGE(before_time_early, "Payload sent before time was available");
+
+	/* Then
+	 * The samples are sent once time is available, timestamped from the uptime when they
+	 * were taken.
+	 */
+	TEST_ASSERT_EQUAL(SAMPLES_BEFORE_TIME, before_time_payload_count);
+	TEST_ASSERT_EQUAL(SAMPLES_BEFORE_TIME, before_time_conversions);
+
+	for (size_t i = 0; i < SAMPLES_BEFORE_TIME; i++) {
+		err = cbor_decode_conn_info_object(before_time_payloads[i].buffer,
+						   before_time_payloads[i].buffer_len,
+						   &conn_info_obj[i], NULL);
+		TEST_ASSERT_EQUAL(ZCBOR_SUCCESS, err);
+		TEST_ASSERT_EQUAL(FAKE_ENERGY_ESTIMATE, conn_info_obj[i].energy_estimate_m.vi);
+		TEST_ASSERT_LESS_THAN(FAKE_TIME_MS / 1000, conn_info_obj[i].base_attributes_m.bt);
+	}
+
+	/* The samples are sent in order, as far apart as they were taken */
+	TEST_ASSERT_INT_WITHIN(1, SAMPLES_BEFORE_TIME_INTERVAL_MS / 1000,
+			       conn_info_obj[1].base_attributes_m.bt -
+			       conn_info_obj[0].base_attributes_m.bt);
+}
 
 void test_energy_estimate(void)
 {
@@ -239,13 +324,23 @@ void test_conn_info_min_values(void)
 	TEST_ASSERT_EQUAL(RSRP_IDX_TO_DBM(FAKE_RSRP_IDX_MIN), conn_info_obj.rsrp_m.vi.vi);
 }
 
-void test_no_events_on_zbus_until_watchdog_timeout(void)
+void test_no_wakeups_without_events_on_zbus(void)
 {
-	/* Wait without feeding any events to zbus until watch dog timeout. */
-	k_sleep(K_SECONDS(CONFIG_APP_NETWORK_WATCHDOG_TIMEOUT_SECONDS));
+	unsigned int checkins;
+
+	/* Let the module handle the events sent during setup */
+	k_sleep(K_MSEC(100));
+
+	checkins = supervisor_checkin_fake.call_count;
+
+	/* Wait without feeding any events to zbus for longer than the supervisor timeout. */
+	k_sleep(K_SECONDS(CONFIG_APP_NETWORK_WATCHDOG_TIMEOUT_SECONDS * 2));
 
-	/* Check if the watchdog was fed atleast once.*/
-	TEST_ASSERT_GREATER_OR_EQUAL(1, task_wdt_feed_fake.call_count);
+	/* The module thread must not have woken up, and must have checked out of the
+	 * events it processed.
+	 */
+	TEST_ASSERT_EQUAL(checkins, supervisor_checkin_fake.call_count);
+	TEST_ASSERT_EQUAL(supervisor_checkin_fake.call_count, supervisor_checkout_fake.call_count);
 }
 
 void test_network_disconnect_request_calls_disconnect_function(void)
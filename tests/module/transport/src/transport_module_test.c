@@ -6,13 +6,15 @@
 #include <unity.h>
 
 #include <zephyr/fff.h>
+#include <dk_buttons_and_leds.h>
 #include "message_channel.h"
-#include <zephyr/task_wdt/task_wdt.h>
+#include "supervisor.h"
 
 DEFINE_FFF_GLOBALS;
 
-FAKE_VALUE_FUNC(int, task_wdt_feed, int);
-FAKE_VALUE_FUNC(int, task_wdt_add, uint32_t, task_wdt_callback_t, void *);
+FAKE_VALUE_FUNC(int, supervisor_add, const struct zbus_observer *, uint32_t);
+FAKE_VOID_FUNC(supervisor_checkin, int);
+FAKE_VOID_FUNC(supervisor_checkout, int);
 FAKE_VALUE_FUNC(int, nrf_cloud_client_id_get, char *, size_t);
 FAKE_VALUE_FUNC(int, nrf_cloud_coap_init);
 FAKE_VALUE_FUNC(int, nrf_cloud_coap_connect, const char * const);
@@ -25,6 +27,67 @@ static K_SEM_DEFINE(cloud_connected_ready, 0, 1);
 static K_SEM_DEFINE(cloud_connected_paused, 0, 1);
 static K_SEM_DEFINE(data_sent, 0, 1);
 static K_SEM_DEFINE(fatal_error_received, 0, 1);
+static K_SEM_DEFINE(bulk_work_start, 0, 1);
+
+/* Duration that the bulk thread keeps the CPU busy and the maximum accepted latency from
+ * a button press until the button payload is sent to cloud while the bulk thread is running.
+ */
+#define BULK_WORK_DURATION_MS	500
+#define SEND_LATENCY_MAX_MS	10
+
+#define FAKE_TIME_MS 1716552398505
+
+static int64_t bytes_send_timestamp;
+static int64_t button_press_timestamp;
+
+/* Button handler registered by the button module */
+static button_handler_t button_handler;
+
+int dk_buttons_init(button_handler_t handler)
+{
+	button_handler = handler;
+	return 0;
+}
+
+int date_time_now(int64_t *time)
+{
+	*time = FAKE_TIME_MS;
+	return 0;
+}
+
+/* The DK buttons library calls the button handler from the system workqueue */
+static void button_press_work_fn(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	button_press_timestamp = k_uptime_get();
+	button_handler(DK_BTN1_MSK, DK_BTN1_MSK);
+}
+
+static K_WORK_DEFINE(button_press_work, button_press_work_fn);
+
+static int bytes_send_timestamp_fake(uint8_t *buf, size_t len, bool confirmable)
+{
+	ARG_UNUSED(buf);
+	ARG_UNUSED(len);
+	ARG_UNUSED(confirmable);
+
+	bytes_send_timestamp = k_uptime_get();
+
+	return 0;
+}
+
+/* Simulates sampling or LED effects in a bulk latency class thread, without yielding */
+static void bulk_task(void)
+{
+	while (true) {
+		k_sem_take(&bulk_work_start, K_FOREVER);
+		k_busy_wait(BULK_WORK_DURATION_MS * USEC_PER_MSEC);
+	}
+}
+
+K_THREAD_DEFINE(bulk_task_id, 1024, bulk_task, NULL, NULL, NULL,
+		CONFIG_APP_THREAD_PRIORITY_BULK, 0, 0);
 
 static void dummy_cb(const struct zbus_channel *chan)
 {
@@ -73,8 +136,8 @@ void setUp(void)
 	const struct zbus_channel *chan;
 
 	/* Reset fakes */
-	RESET_FAKE(task_wdt_feed);
-	RESET_FAKE(task_wdt_add);
+	RESET_FAKE(supervisor_checkin);
+	RESET_FAKE(supervisor_checkout);
 
 	/* Clear all channels */
 	zbus_sub_wait(&location, &chan, K_NO_WAIT);
@@ -169,6 +232,30 @@ void test_connected_paused_to_ready_send_payload(void)
 	TEST_ASSERT_EQUAL(payload.buffer_len, nrf_cloud_coap_bytes_send_fake.arg1_val);
 }
 
+void test_button_send_latency_with_busy_bulk_thread(void)
+{
+	TEST_ASSERT_NOT_NULL(button_handler);
+
+	nrf_cloud_coap_bytes_send_fake.call_count = 0;
+	nrf_cloud_coap_bytes_send_fake.custom_fake = bytes_send_timestamp_fake;
+
+	/* Let the bulk thread occupy the CPU before the button is pressed */
+	k_sem_give(&bulk_work_start);
+	k_sleep(K_MSEC(10));
+
+	k_work_submit(&button_press_work);
+
+	/* Wait for the bulk work to finish, the payload must have been sent long before */
+	k_sleep(K_MSEC(BULK_WORK_DURATION_MS));
+
+	nrf_cloud_coap_bytes_send_fake.custom_fake = NULL;
+
+	/* The button payload is encoded by the button module and sent by the transport module */
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_bytes_send_fake.call_count);
+	TEST_ASSERT_LESS_OR_EQUAL(SEND_LATENCY_MAX_MS,
+				  bytes_send_timestamp - button_press_timestamp);
+}
+
 /* This is required to be added to each test. That is because unity's
  * main may return nonzero, while zephyr's main currently must
  * return 0 in all cases (other values are reserved).
@@ -47,11 +47,24 @@ static void send_config(void)
 {
 #define TEST_UPDATE_INTERVAL_IN_SECONDS 3600
 
-	const struct configuration config = {
+	const struct app_configuration config = {
 		.update_interval_present = true,
 		.update_interval = TEST_UPDATE_INTERVAL_IN_SECONDS,
 	};
-	int err = zbus_chan_pub(&CONFIG_CHAN, &config, K_SECONDS(1));
+	int err = zbus_chan_pub(&APP_CONFIG_CHAN, &config, K_SECONDS(1));
+
+	TEST_ASSERT_EQUAL(0, err);
+}
+
+static void send_frequent_poll_policy(uint32_t duration_sec, uint32_t interval_sec)
+{
+	const struct app_configuration config = {
+		.frequent_poll_duration_present = true,
+		.frequent_poll_duration = duration_sec,
+		.frequent_poll_interval_present = true,
+		.frequent_poll_interval = interval_sec,
+	};
+	int err = zbus_chan_pub(&APP_CONFIG_CHAN, &config, K_SECONDS(1));
 
 	TEST_ASSERT_EQUAL(0, err);
 }
@@ -126,6 +139,22 @@ static void check_trigger_event(enum trigger_type expected_trig_type)
 	TEST_ASSERT_EQUAL(expected_trig_type, trig_type);
 }
 
+/* Consume all pending trigger events and return the number of events of the given type */
+static int trigger_events_count(enum trigger_type type)
+{
+	const struct zbus_channel *chan;
+	enum trigger_type trig_type;
+	int count = 0;
+
+	while (zbus_sub_wait_msg(&trigger_subscriber, &chan, &trig_type, K_NO_WAIT) == 0) {
+		if (trig_type == type) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
 static void check_no_trigger_events(uint32_t time_in_seconds)
 {
 	const struct zbus_channel *chan;
@@ -369,6 +398,25 @@ void test_frequent_poll_to_blocked_to_normal(void)
 	send_cloud_disconnected();
 }
 
+void test_frequent_poll_policy_from_config(void)
+{
+	/* Given */
+	send_frequent_poll_policy(150, 60);
+
+	/* When */
+	go_to_frequent_poll_state();
+	k_sleep(K_SECONDS(150));
+
+	/* Then */
+	TEST_ASSERT_EQUAL(2, trigger_events_count(TRIGGER_POLL));
+	check_trigger_mode_event(TRIGGER_MODE_NORMAL);
+
+	/* Cleanup */
+	send_cloud_disconnected();
+	send_frequent_poll_policy(CONFIG_FREQUENT_POLL_DURATION_INTERVAL_SEC,
+				  FREQUENT_POLL_SHADOW_POLL_TRIGGER_INTERVAL_SEC);
+}
+
 /* This is required to be added to each test. That is because unity's
  * main may return nonzero, while zephyr's main currently must
  * return 0 in all cases (other values are reserved).